@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlAnimationPlayer.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlBatchEncoder.hpp
\ No newline at end of file
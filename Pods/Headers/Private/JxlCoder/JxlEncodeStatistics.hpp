@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlEncodeStatistics.hpp
\ No newline at end of file
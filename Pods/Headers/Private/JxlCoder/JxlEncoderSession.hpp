@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlEncoderSession.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlFrameBuffer.hpp
\ No newline at end of file
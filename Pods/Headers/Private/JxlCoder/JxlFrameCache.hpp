@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlFrameCache.hpp
\ No newline at end of file
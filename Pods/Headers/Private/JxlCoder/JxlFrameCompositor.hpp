@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlFrameCompositor.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlFrameIndex.hpp
\ No newline at end of file
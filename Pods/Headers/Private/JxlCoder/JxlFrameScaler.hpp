@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlFrameScaler.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlInputSource.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlMetadata.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlOutputSink.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlPixelAnalysis.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlResourceEstimator.hpp
\ No newline at end of file
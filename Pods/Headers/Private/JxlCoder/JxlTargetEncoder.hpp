@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlTargetEncoder.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../JxlCoder/Sources/jxlc/JxlToneMapper.hpp
\ No newline at end of file
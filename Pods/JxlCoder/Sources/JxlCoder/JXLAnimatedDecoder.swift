@@ -32,8 +32,18 @@ public class JXLAnimatedDecoder {
 
     private let dec: CJpegXLAnimatedDecoder
 
-    public init(data: Data) throws {
-        dec = try CJpegXLAnimatedDecoder(data)
+    /// `pixelFormat` selects 8-bit, float16 or u16 frames, or 8-bit frames tone mapped from HDR
+    public init(data: Data, pixelFormat: JXLAnimatedPixelFormat = .r8) throws {
+        dec = try CJpegXLAnimatedDecoder(data, pixelFormat: pixelFormat)
+    }
+
+    /**
+     Memory maps the file, so a large animation stays resident only while its pages are in use.
+     A mapped file must not be truncated or rewritten while the decoder is alive, the process would crash
+     with SIGBUS, pass `mapped: false` to read files that may change into memory instead
+     */
+    public init(url: URL, pixelFormat: JXLAnimatedPixelFormat = .r8, mapped: Bool = true) throws {
+        dec = try CJpegXLAnimatedDecoder(contentsOfFile: url.path, pixelFormat: pixelFormat, mapped: mapped)
     }
 
     public var numberOfFrames: Int {
@@ -44,6 +54,39 @@ public class JXLAnimatedDecoder {
         return Int(dec.frameDuration(Int32(frame)))
     }
 
+    /// Area of `frame` that differs from the previous frame in display order
+    public func changedRect(_ frame: Int) -> CGRect {
+        dec.changedRect(Int32(frame))
+    }
+
+    /**
+     Area of `frame` that differs from the `shown` frame the caller displays, with its position on the canvas.
+     The whole frame unless `shown` directly precedes it, e.g. after seeking or skipping frames,
+     so only this part needs to be uploaded. Nil when the frame repeats the shown one
+     */
+    public func region(frame: Int, shown: Int?) throws -> (image: JXLPlatformImage, rect: CGRect)? {
+        var rect = CGRect.zero
+        guard let image = try dec.getRegion(Int32(frame), shown: Int32(shown ?? -1), rect: &rect) else {
+            return nil
+        }
+        return (image, rect)
+    }
+
+    /// Duration of one loop
+    public var duration: TimeInterval {
+        dec.totalDuration()
+    }
+
+    /// Index of the frame on screen at `time` from the start of playback, loops are taken into account
+    public func frameIndex(at time: TimeInterval) -> Int {
+        Int(dec.frame(at: time))
+    }
+
+    /// Frame on screen at `time`, decodes only what this frame depends on
+    public func seek(to time: TimeInterval) throws -> JXLPlatformImage {
+        try dec.seek(time)
+    }
+
     public var loopsCount: Int {
         Int(dec.loopCount())
     }
@@ -52,4 +95,60 @@ public class JXLAnimatedDecoder {
         try dec.get(Int32(frame))
     }
 
+    /// Frame resampled to `size`, filter weights are reused for every frame of the same size
+    public func get(frame: Int, size: CGSize, sampler: JxlSampler = .bilinear) throws -> JXLPlatformImage {
+        try dec.get(Int32(frame), size: size, sampler: sampler)
+    }
+
+    /// Keeps decoded frames within `budget` bytes, so looping animations are decoded once.
+    /// Over budget frames are packed, downscaled when allowed, and evicted least recently used first
+    /// unless `keepWholeLoop` which keeps the already cached part of the loop instead. Zero disables the cache.
+    /// Downscaled frames serve only frames requested at half size or less unless `acceptLossyFrames`
+    public func enableFrameCache(budget: Int, keepWholeLoop: Bool = true, allowDownscale: Bool = false,
+                                 acceptLossyFrames: Bool = false) {
+        dec.setFrameCacheBudget(UInt(budget), keepWholeLoop: keepWholeLoop, allowDownscale: allowDownscale)
+        dec.setAcceptsLossyFrames(acceptLossyFrames)
+    }
+
+    /// Shrinks frame cache, e.g. on memory warning
+    public func trimFrameCache(to budget: Int) {
+        dec.trimFrameCache(UInt(budget))
+    }
+
+    /// Allows frames requested from different threads to be decoded concurrently by up to `count` decoders
+    public func setConcurrentDecoders(_ count: Int) {
+        dec.setConcurrentDecoders(UInt(max(count, 1)))
+    }
+
+    /// Starts decoding frames ahead on a background thread, `depth` is the number of decoded frames kept ready
+    public func startPlayback(depth: Int = 3) {
+        dec.startPlayback(UInt(depth))
+    }
+
+    public func stopPlayback() {
+        dec.stopPlayback()
+    }
+
+    /// Frame to display at `time` seconds since `startPlayback`, nil while the previous frame should stay on screen
+    public func playbackFrame(at time: TimeInterval) throws -> JXLPlatformImage? {
+        try dec.playbackFrame(at: time)
+    }
+
+    /// Same as `playbackFrame(at:)` with the area that differs from the previously returned frame
+    public func playbackFrameWithChanges(at time: TimeInterval) throws -> (image: JXLPlatformImage, changed: CGRect)? {
+        var rect = CGRect.zero
+        guard let image = try dec.playbackFrame(at: time, changedRect: &rect) else {
+            return nil
+        }
+        return (image, rect)
+    }
+
+    public var droppedFrames: Int {
+        Int(dec.droppedFrames())
+    }
+
+    public var underruns: Int {
+        Int(dec.underruns())
+    }
+
 }
@@ -54,6 +54,64 @@ public class JXLAnimatedEncoder {
         try enc.addFrame(frame, duration: Int32(ms))
     }
 
+    /**
+     Same as add(frame:duration:) but encodes in background, so the caller can render the next frame meanwhile.
+     Blocks only when `queueDepth` frames are already waiting
+     - Parameter frame: all the frames must match provided width and height in constructor
+     - Parameter duration: length of the frame in milliseconds
+     */
+    public func enqueue(frame: JXLPlatformImage, duration ms: Int) throws {
+        try enc.enqueueFrame(frame, duration: Int32(ms))
+    }
+
+    /// Maximum number of frames waiting for encoding
+    public func setQueueDepth(_ depth: Int) {
+        enc.setQueueDepth(UInt(max(depth, 1)))
+    }
+
+    public var queueDepth: Int {
+        Int(enc.queueDepth())
+    }
+
+    public var peakQueueDepth: Int {
+        Int(enc.peakQueueDepth())
+    }
+
+    /// How many times `enqueue` had to wait for the encoder and for how long in total
+    public var queueStalls: Int {
+        Int(enc.queueStalls())
+    }
+
+    public var queueStallTime: TimeInterval {
+        enc.queueStallTime()
+    }
+
+    /**
+     Writes the image to the file while frames are being added, memory doesn't grow with the animation length.
+     Must be called before adding frames, `finish()` then completes the file and returns empty data.
+     The partial file is removed when writing fails or the encoder is released before `finish()`
+     */
+    public func stream(to url: URL) throws {
+        try enc.stream(toFile: url.path)
+    }
+
+    /// File or socket descriptor, it stays open after `finish()`, after an error it holds an incomplete image
+    public func stream(toFileDescriptor fd: Int32) throws {
+        try enc.stream(toFileDescriptor: fd)
+    }
+
+    /**
+     - Parameter handler: receives encoded chunks in order on the encoding thread, return false to abort encoding.
+       Chunks received before an error don't form a valid image
+     */
+    public func stream(_ handler: @escaping (Data) -> Bool) throws {
+        try enc.stream { handler($0) }
+    }
+
+    public var bytesWritten: UInt64 {
+        enc.bytesWritten()
+    }
+
     public func finish() throws -> Data {
         try enc.finish()
     }
@@ -90,17 +90,152 @@ public class JXLCoder {
     /***
      - Parameter quality: 0...100
      - Parameter effort: 1...9
+     - Parameter colorProfile: .image keeps pixels and ICC profile of the image, other profiles
+       convert pixels and store the enumerated encoding, e.g. .rec2100PQ or .rec2100HLG for HDR
+     - Parameter metadata: Exif, XMP or other boxes to store in the file
      - Returns: JXL data of the image
      **/
     public static func encode(image: JXLPlatformImage,
                               colorSpace: JXLColorSpace = .rgb,
                               compressionOption: JXLCompressionOption = .lossy,
                               effort: Int = 7,
-                              quality: Int = 0) throws -> Data {
+                              quality: Int = 0,
+                              colorProfile: JXLEncodingColorProfile = .image,
+                              metadata: [JXLMetadataBox] = []) throws -> Data {
         return try shared.encode(image, colorSpace: colorSpace,
                                  compressionOption: compressionOption,
                                  effort: Int32(effort),
-                                 quality: Int32(quality))
+                                 quality: Int32(quality),
+                                 colorProfile: colorProfile,
+                                 progressive: false,
+                                 metadata: metadata,
+                                 passOffsets: nil,
+                                 statistics: nil)
+    }
+
+    /***
+     Same as encode, also reports stage timings, CPU time, memory and bytes per codestream section
+     of the encode, e.g. `statistics.bytes(in: .ac)`. CPU time counts only this encode
+     - Parameter quality: 0...100
+     - Parameter effort: 1...9
+     - Returns: JXL data of the image and statistics of this encode
+     **/
+    public static func encodeWithStatistics(image: JXLPlatformImage,
+                                            colorSpace: JXLColorSpace = .rgb,
+                                            compressionOption: JXLCompressionOption = .lossy,
+                                            effort: Int = 7,
+                                            quality: Int = 0) throws -> (data: Data, statistics: JXLEncodeStatistics) {
+        var statistics: JXLEncodeStatistics?
+        let data = try shared.encode(image, colorSpace: colorSpace,
+                                     compressionOption: compressionOption,
+                                     effort: Int32(effort),
+                                     quality: Int32(quality),
+                                     colorProfile: .image,
+                                     progressive: false,
+                                     metadata: nil,
+                                     passOffsets: nil,
+                                     statistics: &statistics)
+        guard let statistics = statistics else {
+            throw NSError(domain: "JXLCoder", code: 500,
+                          userInfo: [NSLocalizedDescriptionKey: "Encoding statistics are missing"])
+        }
+        return (data, statistics)
+    }
+
+    /***
+     Reads metadata boxes without decoding the image
+     - Returns: Exif, XMP and other boxes stored in the file, empty if file is a bare codestream
+     **/
+    public static func metadata(data: Data) throws -> [JXLMetadataBox] {
+        return try shared.readMetadata(data)
+    }
+
+    /***
+     Encodes image progressively so it may be rendered before whole file arrives
+     - Parameter quality: 0...100
+     - Parameter effort: 1...9
+     - Returns: JXL data of the image and byte offsets where each progressive pass becomes renderable
+     **/
+    public static func encodeProgressive(image: JXLPlatformImage,
+                                         colorSpace: JXLColorSpace = .rgb,
+                                         compressionOption: JXLCompressionOption = .lossy,
+                                         effort: Int = 7,
+                                         quality: Int = 0) throws -> (data: Data, passOffsets: [Int]) {
+        var offsets: NSArray?
+        let data = try shared.encode(image, colorSpace: colorSpace,
+                                     compressionOption: compressionOption,
+                                     effort: Int32(effort),
+                                     quality: Int32(quality),
+                                     colorProfile: .image,
+                                     progressive: true,
+                                     metadata: nil,
+                                     passOffsets: &offsets,
+                                     statistics: nil)
+        let passOffsets = (offsets as? [NSNumber])?.map { $0.intValue } ?? []
+        return (data, passOffsets)
+    }
+
+    /***
+     Searches the smallest file that still meets the target
+     - Parameter target: .ssim for minimal SSIM 0...1 of the result, .size for maximum size in bytes
+     - Parameter effort: 1...9
+     - Returns: JXL data of the image
+     - Throws: when no distance meets the target, the error tells the closest reachable score
+     **/
+    public static func encode(image: JXLPlatformImage,
+                              colorSpace: JXLColorSpace = .rgb,
+                              effort: Int = 7,
+                              target: JXLQualityTarget,
+                              value: Double) throws -> Data {
+        return try shared.encode(image, colorSpace: colorSpace,
+                                 effort: Int32(effort),
+                                 target: target,
+                                 targetValue: value)
+    }
+
+    /***
+     Encodes several images at once, balancing threads between images and inside each image
+     - Parameter quality: 0...100
+     - Parameter effort: 1...9
+     - Returns: JXL data of the images in the same order
+     **/
+    public static func encode(images: [JXLPlatformImage],
+                              colorSpace: JXLColorSpace = .rgb,
+                              compressionOption: JXLCompressionOption = .lossy,
+                              effort: Int = 7,
+                              quality: Int = 0) throws -> [Data] {
+        return try shared.encodeBatch(images, colorSpace: colorSpace,
+                                      compressionOption: compressionOption,
+                                      effort: Int32(effort),
+                                      quality: Int32(quality))
+    }
+
+    /***
+     Predicts peak memory and CPU of an encode before it's started, so jobs may be admitted
+     without running out of memory. CPU time is known only after `calibrateResourceEstimator`
+     - Parameter effort: 1...9
+     **/
+    public static func estimateResources(size: CGSize,
+                                         colorSpace: JXLColorSpace = .rgb,
+                                         compressionOption: JXLCompressionOption = .lossy,
+                                         effort: Int = 7) -> JXLResourceEstimate {
+        return shared.estimateResources(size, colorSpace: colorSpace,
+                                        compressionOption: compressionOption,
+                                        effort: Int32(effort))
+    }
+
+    /***
+     Refits the estimator against real encodings on this device, takes seconds and up to minutes
+     for efforts 8 and 9. Heap of the whole process is sampled, no other encoding may run meanwhile
+     - Parameter efforts: efforts to measure, others keep their previous coefficients
+     - Parameter side: side of the larger synthetic square image, 64...16384
+     **/
+    public static func calibrateResourceEstimator(efforts: [Int] = [1, 3, 5, 7], side: Int = 1024) throws {
+        try shared.calibrateResourceEstimator(efforts.map { NSNumber(value: $0) }, side: side)
+    }
+
+    public static var isResourceEstimatorCalibrated: Bool {
+        shared.isResourceEstimatorCalibrated()
     }
 
     /***
@@ -29,13 +29,74 @@
 #import "JXLSystemImage.hpp"
 #import <Foundation/Foundation.h>
 
+typedef NS_ENUM(NSInteger, JXLAnimatedPixelFormat) {
+    // Float16 for animations with more than 8 bits per sample, 8-bit otherwise
+    kAnimatedOptimal NS_SWIFT_NAME(optimal),
+    kAnimatedR8 NS_SWIFT_NAME(r8),
+    kAnimatedFloat16 NS_SWIFT_NAME(float16),
+    kAnimatedU16 NS_SWIFT_NAME(u16),
+    // HDR animations are tone mapped to SDR while decoding, others are plain 8-bit
+    kAnimatedToneMappedR8 NS_SWIFT_NAME(toneMappedR8)
+};
+
 @interface CJpegXLAnimatedDecoder : NSObject
 -(nullable id)initWith:(nonnull NSData*)data error:(NSError * _Nullable *_Nullable)error;
+-(nullable id)initWith:(nonnull NSData*)data
+           pixelFormat:(JXLAnimatedPixelFormat)pixelFormat
+                 error:(NSError * _Nullable *_Nullable)error;
+// File is memory mapped instead of read, truncating it while the decoder is alive crashes with SIGBUS
+-(nullable id)initWithContentsOfFile:(nonnull NSString*)path error:(NSError * _Nullable *_Nullable)error;
+-(nullable id)initWithContentsOfFile:(nonnull NSString*)path
+                         pixelFormat:(JXLAnimatedPixelFormat)pixelFormat
+                               error:(NSError * _Nullable *_Nullable)error;
+// Not mapped files are read into memory once, for files that may be modified while they are decoded
+-(nullable id)initWithContentsOfFile:(nonnull NSString*)path
+                         pixelFormat:(JXLAnimatedPixelFormat)pixelFormat
+                              mapped:(bool)mapped
+                               error:(NSError * _Nullable *_Nullable)error;
 -(NSUInteger)framesCount;
 -(int)frameDuration:(int)frame;
 -(int)loopCount;
+// Duration of one loop in seconds
+-(double)totalDuration;
+// Frame on screen at time from the start of playback, loops are taken into account
+-(int)frameAt:(double)seconds NS_SWIFT_NAME(frame(at:));
+-(nullable JXLSystemImage *)seek:(double)seconds
+                            error:(NSError *_Nullable * _Nullable)error;
 -(nullable JXLSystemImage *)get:(int)frame
                             error:(NSError *_Nullable * _Nullable)error;
+// Frame resampled to size, small sizes avoid decoding the frame at full resolution
+-(nullable JXLSystemImage *)get:(int)frame
+                            size:(CGSize)size
+                         sampler:(JxlSampler)sampler
+                           error:(NSError *_Nullable * _Nullable)error;
+// Area that differs from the previous frame in display order, whole canvas when it can't be narrowed down
+-(CGRect)changedRect:(int)frame;
+// Only the area of the frame that differs from the shown frame, placed at rect on the canvas.
+// Whole frame unless shown directly precedes it or is -1, nil without an error when nothing changed
+-(nullable JXLSystemImage *)getRegion:(int)frame
+                                shown:(int)shown
+                                 rect:(nonnull CGRect*)rect
+                                error:(NSError *_Nullable * _Nullable)error
+    __attribute__((swift_error(nonnull_error)));
+-(void)setFrameCacheBudget:(NSUInteger)bytes keepWholeLoop:(bool)keepWholeLoop allowDownscale:(bool)allowDownscale;
+-(void)trimFrameCache:(NSUInteger)bytes;
+// Full size frames may come upscaled from half resolution cache entries instead of being decoded again
+-(void)setAcceptsLossyFrames:(bool)accepts;
+-(void)setConcurrentDecoders:(NSUInteger)count;
+-(void)startPlayback:(NSUInteger)depth;
+-(void)stopPlayback;
+// Returns nil without an error while the previously returned frame stays on screen
+-(nullable JXLSystemImage *)playbackFrameAt:(double)seconds
+                                      error:(NSError *_Nullable * _Nullable)error
+    __attribute__((swift_error(nonnull_error))) NS_SWIFT_NAME(playbackFrame(at:));
+// Same frame with the area that differs from the previously returned one, whole canvas after dropped frames
+-(nullable JXLSystemImage *)playbackFrameAt:(double)seconds
+                                changedRect:(nonnull CGRect*)rect
+                                      error:(NSError *_Nullable * _Nullable)error
+    __attribute__((swift_error(nonnull_error))) NS_SWIFT_NAME(playbackFrame(at:changedRect:));
+-(NSUInteger)droppedFrames;
+-(NSUInteger)underruns;
 @end
 
 #endif /* JPEGXL_ANIMATED_DECODER_H */
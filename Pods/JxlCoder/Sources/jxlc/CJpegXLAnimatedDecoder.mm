@@ -26,31 +26,119 @@
 #import <Foundation/Foundation.h>
 #import "CJpegXLAnimatedDecoder.h"
 #import "JxlAnimatedDecoder.hpp"
+#import "JxlAnimationPlayer.hpp"
+#import "JxlInputSource.hpp"
 #include <vector>
+#include <memory>
 
-template <typename DataType>
 class JXLDDataWrapper {
 public:
-    JXLDDataWrapper(const std::vector<DataType>& src): data(src) {}
-    const std::vector<DataType> data;
+    JXLDDataWrapper(const std::vector<uint8_t>& src): data(src) {}
+    const std::vector<uint8_t> data;
 };
 
 static void JXLDCGData8ProviderReleaseDataCallback(void *info, const void *data, size_t size) {
-    auto dataWrapper = static_cast<JXLDDataWrapper<uint8_t>*>(info);
+    auto dataWrapper = static_cast<JXLDDataWrapper*>(info);
     delete dataWrapper;
 }
 
+// Keeps pooled frame alive while CoreGraphics holds the image, buffer goes back to the pool after
+class JXLDFrameBufferWrapper {
+public:
+    JXLDFrameBufferWrapper(JxlFrameBuffer&& buffer): buffer(std::move(buffer)) {}
+    JxlFrameBuffer buffer;
+};
+
+static void JXLDCGFrameBufferReleaseDataCallback(void *info, const void *data, size_t size) {
+    auto bufferWrapper = static_cast<JXLDFrameBufferWrapper*>(info);
+    delete bufferWrapper;
+}
+
 @implementation CJpegXLAnimatedDecoder {
     JxlAnimatedDecoder* dec;
-    std::vector<uint8_t> mSrc;
+    std::unique_ptr<JxlAnimationPlayer> player;
+    const JxlPlaybackFrame* shownFrame;
+    double shownTime;
 }
 
 -(nullable id)initWith:(nonnull NSData*)data error:(NSError * _Nullable *_Nullable)error {
+    return [self initWith:data pixelFormat:kAnimatedR8 error:error];
+}
+
+-(nullable id)initWith:(nonnull NSData*)data
+           pixelFormat:(JXLAnimatedPixelFormat)pixelFormat
+                 error:(NSError * _Nullable *_Nullable)error {
+    // Immutable data is retained rather than copied, mutable data is copied once
+    NSData* bytes = [data copy];
+    const void* owner = CFBridgingRetain(bytes);
+    auto source = std::make_shared<JxlInputSource>(reinterpret_cast<const uint8_t*>([bytes bytes]),
+                                                   static_cast<size_t>([bytes length]),
+                                                   std::shared_ptr<const void>(owner, [](const void* retained) {
+        CFRelease(retained);
+    }));
+    return [self initWithSource:source pixelFormat:pixelFormat error:error];
+}
+
+-(nullable id)initWithContentsOfFile:(nonnull NSString*)path error:(NSError * _Nullable *_Nullable)error {
+    return [self initWithContentsOfFile:path pixelFormat:kAnimatedR8 error:error];
+}
+
+-(nullable id)initWithContentsOfFile:(nonnull NSString*)path
+                         pixelFormat:(JXLAnimatedPixelFormat)pixelFormat
+                               error:(NSError * _Nullable *_Nullable)error {
+    return [self initWithContentsOfFile:path pixelFormat:pixelFormat mapped:true error:error];
+}
+
+-(nullable id)initWithContentsOfFile:(nonnull NSString*)path
+                         pixelFormat:(JXLAnimatedPixelFormat)pixelFormat
+                              mapped:(bool)mapped
+                               error:(NSError * _Nullable *_Nullable)error {
+    std::shared_ptr<JxlInputSource> source;
     try {
-        const uint8_t* ptr = reinterpret_cast<const uint8_t*>([data bytes]);
-        mSrc.resize([data length]);
-        std::copy(ptr, ptr + [data length], mSrc.begin());
-        dec = new JxlAnimatedDecoder(mSrc);
+        const std::string filePath([path fileSystemRepresentation]);
+        source = mapped ? JxlMapInputSource(filePath) : JxlReadInputSource(filePath);
+    } catch (std::bad_alloc &err) {
+        NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JpegXLAnimatedDecoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    }
+    if (!source) {
+        NSString *str = [NSString stringWithFormat:mapped ? @"Cannot map file %@" : @"Cannot read file %@", path];
+        *error = [[NSError alloc] initWithDomain:@"JpegXLAnimatedDecoder"
+                                            code:500
+                                        userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    }
+    return [self initWithSource:source pixelFormat:pixelFormat error:error];
+}
+
+-(nullable id)initWithSource:(std::shared_ptr<JxlInputSource>)source
+                 pixelFormat:(JXLAnimatedPixelFormat)pixelFormat
+                       error:(NSError * _Nullable *_Nullable)error {
+    JxlDecodingPixelFormat decodingFormat = r8;
+    bool toneMap = false;
+    switch (pixelFormat) {
+        case kAnimatedOptimal:
+            decodingFormat = optimal;
+            break;
+        case kAnimatedR8:
+            decodingFormat = r8;
+            break;
+        case kAnimatedFloat16:
+            decodingFormat = float16;
+            break;
+        case kAnimatedU16:
+            decodingFormat = u16;
+            break;
+        case kAnimatedToneMappedR8:
+            decodingFormat = r8;
+            toneMap = true;
+            break;
+    }
+    try {
+        dec = new JxlAnimatedDecoder(source, compositeLibjxl, decodingFormat, toneMap);
+        // First frame is available right away, frames count is usually asked for soon after
+        dec->indexInBackground();
     } catch (AnimatedDecoderError& err) {
         NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
         *error = [[NSError alloc] initWithDomain:@"JpegXLAnimatedDecoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
@@ -63,68 +151,203 @@ static void JXLDCGData8ProviderReleaseDataCallback(void *info, const void *data,
     return self;
 }
 
+-(nullable JXLSystemImage *)makeImage:(const std::vector<uint8_t>&)pixels
+                            iccProfile:(const std::vector<uint8_t>&)iccProfile
+                                 error:(NSError *_Nullable * _Nullable)error {
+    auto wrapper = new JXLDDataWrapper(pixels);
+
+    CGDataProviderRef provider = CGDataProviderCreateWithData(wrapper,
+                                                              wrapper->data.data(),
+                                                              wrapper->data.size(),
+                                                              JXLDCGData8ProviderReleaseDataCallback);
+    if (!provider) {
+        delete wrapper;
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder"
+                                            code:500
+                                        userInfo:@{ NSLocalizedDescriptionKey: @"CoreGraphics cannot allocate required provider" }];
+        return nullptr;
+    }
+    return [self makeImage:provider width:dec->getWidth() height:dec->getHeight() iccProfile:iccProfile error:error];
+}
+
+-(nullable JXLSystemImage *)makeImage:(JxlFrame&)frame
+                                error:(NSError *_Nullable * _Nullable)error {
+    auto wrapper = new JXLDFrameBufferWrapper(std::move(frame.pixels));
+
+    CGDataProviderRef provider = CGDataProviderCreateWithData(wrapper,
+                                                              wrapper->buffer.data(),
+                                                              wrapper->buffer.size(),
+                                                              JXLDCGFrameBufferReleaseDataCallback);
+    if (!provider) {
+        delete wrapper;
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder"
+                                            code:500
+                                        userInfo:@{ NSLocalizedDescriptionKey: @"CoreGraphics cannot allocate required provider" }];
+        return nullptr;
+    }
+    return [self makeImage:provider width:frame.width height:frame.height iccProfile:*frame.iccProfile error:error];
+}
+
+-(nullable JXLSystemImage *)makeImage:(CGDataProviderRef)provider
+                                width:(int)width
+                               height:(int)height
+                           iccProfile:(const std::vector<uint8_t>&)iccProfile
+                                error:(NSError *_Nullable * _Nullable)error {
+    const JxlDecodingPixelFormat pixelFormat = dec->getPixelFormat();
+    const bool highBitDepth = pixelFormat == float16 || pixelFormat == u16;
+    int bitsPerComponent = (highBitDepth ? sizeof(uint16_t) : sizeof(uint8_t)) * 8;
+    int components = 4;
+    int bitsPerPixel = bitsPerComponent*components;
+    int stride = 4 * width * (highBitDepth ? sizeof(uint16_t) : sizeof(uint8_t));
+
+    CGColorSpaceRef colorSpace;
+    if (dec->isToneMapping()) {
+        // Tone mapped pixels use the sRGB transfer in the primaries of the animation
+        CFStringRef name = kCGColorSpaceSRGB;
+        if (dec->getPrimaries() == JXL_PRIMARIES_P3) {
+            name = kCGColorSpaceDisplayP3;
+        } else if (dec->getPrimaries() == JXL_PRIMARIES_2100) {
+            if (@available(macOS 12.0, iOS 15.1, tvOS 15.1, watchOS 8.1, *)) {
+                name = kCGColorSpaceITUR_2020_sRGBGamma;
+            } else {
+                name = kCGColorSpaceITUR_2020;
+            }
+        }
+        colorSpace = CGColorSpaceCreateWithName(name);
+    } else if (iccProfile.size() > 0) {
+        CFDataRef iccData = CFDataCreate(kCFAllocatorDefault, iccProfile.data(), iccProfile.size());
+        colorSpace = CGColorSpaceCreateWithICCData(iccData);
+        CFRelease(iccData);
+    } else {
+        colorSpace = CGColorSpaceCreateDeviceRGB();
+    }
+
+    if (!colorSpace) {
+        colorSpace = CGColorSpaceCreateDeviceRGB();
+    }
+
+    int flags;
+    if (pixelFormat == float16) {
+        flags = (int)kCGBitmapByteOrder16Host | (int)kCGBitmapFloatComponents;
+    } else if (pixelFormat == u16) {
+        flags = (int)kCGBitmapByteOrder16Host;
+    } else {
+        flags = (int)kCGImageByteOrderDefault;
+    }
+    if (components == 4) {
+        flags |= (int)kCGImageAlphaLast;
+    } else {
+        flags |= (int)kCGImageAlphaNone;
+    }
+
+    CGImageRef imageRef = CGImageCreate(width, height, bitsPerComponent,
+                                        bitsPerPixel,
+                                        stride,
+                                        colorSpace, flags, provider, NULL, false, kCGRenderingIntentDefault);
+    // Image retains provider, the pooled buffer is released once the image is gone
+    CGDataProviderRelease(provider);
+    CGColorSpaceRelease(colorSpace);
+    if (!imageRef) {
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder"
+                                            code:500
+                                        userInfo:@{ NSLocalizedDescriptionKey: @"CoreGraphics cannot allocate CGImageRef" }];
+        return NULL;
+    }
+    JXLSystemImage *image = nil;
+#if JXL_PLUGIN_MAC
+    image = [[NSImage alloc] initWithCGImage:imageRef size:CGSizeZero];
+#else
+    image = [UIImage imageWithCGImage:imageRef scale:1 orientation:UIImageOrientationUp];
+#endif
+    CGImageRelease(imageRef);
+
+    return image;
+}
+
 -(nullable JXLSystemImage *)get:(int)frame
                             error:(NSError *_Nullable * _Nullable)error {
     try {
         JxlFrame jxlFrame = dec->getFrame(frame);
-        auto wrapper = new JXLDDataWrapper<uint8_t>(jxlFrame.pixels);
-
-        CGDataProviderRef provider = CGDataProviderCreateWithData(wrapper,
-                                                                  wrapper->data.data(),
-                                                                  wrapper->data.size(),
-                                                                  JXLDCGData8ProviderReleaseDataCallback);
-        if (!provider) {
-            delete wrapper;
-            *error = [[NSError alloc] initWithDomain:@"JXLCoder"
-                                                code:500
-                                            userInfo:@{ NSLocalizedDescriptionKey: @"CoreGraphics cannot allocate required provider" }];
-            return nullptr;
-        }
-
-        int bitsPerComponent = sizeof(uint8_t) * 8;
-        int components = 4;
-        int bitsPerPixel = bitsPerComponent*components;
-        int stride = 4 * dec->getWidth() * sizeof(uint8_t);
-
-        CGColorSpaceRef colorSpace;
-        if (jxlFrame.iccProfile.size() > 0) {
-            CFDataRef iccData = CFDataCreate(kCFAllocatorDefault, jxlFrame.iccProfile.data(), jxlFrame.iccProfile.size());
-            colorSpace = CGColorSpaceCreateWithICCData(iccData);
-            CFRelease(iccData);
-        } else {
-            colorSpace = CGColorSpaceCreateDeviceRGB();
-        }
+        return [self makeImage:jxlFrame error:error];
+    } catch (AnimatedDecoderError& err) {
+        NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JpegXLAnimatedDecoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    } catch (std::bad_alloc &err) {
+        NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JpegXLAnimatedDecoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    }
+}
 
-        if (!colorSpace) {
-            colorSpace = CGColorSpaceCreateDeviceRGB();
-        }
+-(nullable JXLSystemImage *)get:(int)frame
+                            size:(CGSize)size
+                         sampler:(JxlSampler)sampler
+                           error:(NSError *_Nullable * _Nullable)error {
+    XSampler xSampler = bilinear;
+    switch (sampler) {
+        case kNearestNeighbor:
+            xSampler = nearest;
+            break;
+        case kBilinear:
+            xSampler = bilinear;
+            break;
+        case kCubic:
+            xSampler = cubic;
+            break;
+        case kMitchell:
+            xSampler = mitchell;
+            break;
+        case kLanczos:
+            xSampler = lanczos;
+            break;
+        case kCatmullRom:
+            xSampler = catmullRom;
+            break;
+        case kHermite:
+            xSampler = hermite;
+            break;
+        case kBSpline:
+            xSampler = bSpline;
+            break;
+        case kHann:
+            xSampler = hann;
+            break;
+    }
+    try {
+        JxlFrame jxlFrame = dec->getFrame(frame, (int)size.width, (int)size.height, xSampler);
+        return [self makeImage:jxlFrame error:error];
+    } catch (AnimatedDecoderError& err) {
+        NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JpegXLAnimatedDecoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    } catch (std::bad_alloc &err) {
+        NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JpegXLAnimatedDecoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    }
+}
 
-        int flags;
-        flags = (int)kCGImageByteOrderDefault;
-        if (components == 4) {
-            flags |= (int)kCGImageAlphaLast;
-        } else {
-            flags |= (int)kCGImageAlphaNone;
-        }
+-(CGRect)changedRect:(int)frame {
+    JxlCanvasRect rect = dec->getChangedRect(frame);
+    if (rect.empty()) {
+        return CGRectZero;
+    }
+    return CGRectMake(rect.x0, rect.y0, rect.x1 - rect.x0, rect.y1 - rect.y0);
+}
 
-        CGImageRef imageRef = CGImageCreate(dec->getWidth(), dec->getHeight(), bitsPerComponent,
-                                            bitsPerPixel,
-                                            stride,
-                                            colorSpace, flags, provider, NULL, false, kCGRenderingIntentDefault);
-        if (!imageRef) {
-            *error = [[NSError alloc] initWithDomain:@"JXLCoder"
-                                                code:500
-                                            userInfo:@{ NSLocalizedDescriptionKey: @"CoreGraphics cannot allocate CGImageRef" }];
-            return NULL;
+-(nullable JXLSystemImage *)getRegion:(int)frame
+                                shown:(int)shown
+                                 rect:(nonnull CGRect*)rect
+                                error:(NSError *_Nullable * _Nullable)error {
+    try {
+        JxlFrame jxlFrame = dec->getFrameRegion(frame, shown);
+        if (jxlFrame.changed.empty()) {
+            *rect = CGRectZero;
+            return nil;
         }
-        JXLSystemImage *image = nil;
-    #if JXL_PLUGIN_MAC
-        image = [[NSImage alloc] initWithCGImage:imageRef size:CGSizeZero];
-    #else
-        image = [UIImage imageWithCGImage:imageRef scale:1 orientation:UIImageOrientationUp];
-    #endif
-
-        return image;
+        *rect = CGRectMake(jxlFrame.changed.x0, jxlFrame.changed.y0, jxlFrame.width, jxlFrame.height);
+        return [self makeImage:jxlFrame error:error];
     } catch (AnimatedDecoderError& err) {
         NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
         *error = [[NSError alloc] initWithDomain:@"JpegXLAnimatedDecoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
@@ -136,6 +359,87 @@ static void JXLDCGData8ProviderReleaseDataCallback(void *info, const void *data,
     }
 }
 
+-(void)setFrameCacheBudget:(NSUInteger)bytes keepWholeLoop:(bool)keepWholeLoop allowDownscale:(bool)allowDownscale {
+    dec->setFrameCache(static_cast<size_t>(bytes), keepWholeLoop ? cacheWholeLoop : cacheLRU, allowDownscale);
+}
+
+-(void)trimFrameCache:(NSUInteger)bytes {
+    if (std::shared_ptr<JxlFrameCache> cache = dec->getFrameCache()) {
+        cache->setBudget(static_cast<size_t>(bytes));
+    }
+}
+
+-(void)setAcceptsLossyFrames:(bool)accepts {
+    dec->setLossyFrames(accepts);
+}
+
+-(void)setConcurrentDecoders:(NSUInteger)count {
+    dec->setMaxInstances(static_cast<size_t>(count));
+}
+
+-(void)startPlayback:(NSUInteger)depth {
+    if (player) {
+        player->stop();
+    }
+    player = std::make_unique<JxlAnimationPlayer>(*dec, static_cast<size_t>(depth));
+    shownFrame = nullptr;
+    shownTime = -1;
+    player->start();
+}
+
+-(void)stopPlayback {
+    if (player) {
+        player->stop();
+        player.reset();
+    }
+    shownFrame = nullptr;
+}
+
+-(nullable JXLSystemImage *)playbackFrameAt:(double)seconds error:(NSError *_Nullable * _Nullable)error {
+    CGRect rect;
+    return [self playbackFrameAt:seconds changedRect:&rect error:error];
+}
+
+-(nullable JXLSystemImage *)playbackFrameAt:(double)seconds
+                                changedRect:(nonnull CGRect*)rect
+                                      error:(NSError *_Nullable * _Nullable)error {
+    *rect = CGRectZero;
+    if (!player) {
+        return nil;
+    }
+    if (player->hasFailed()) {
+        NSString *str = [[NSString alloc] initWithCString:player->getErrorMessage().c_str() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JpegXLAnimatedDecoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    }
+    JxlCanvasRect changed;
+    const JxlPlaybackFrame* frame = player->frameAt(seconds * 1000.0, &changed);
+    // Slots are reused, presentation time tells apart a new frame in the same slot
+    if (!frame || (frame == shownFrame && frame->presentationTime == shownTime)) {
+        return nil;
+    }
+    shownFrame = frame;
+    shownTime = frame->presentationTime;
+    if (!changed.empty()) {
+        *rect = CGRectMake(changed.x0, changed.y0, changed.x1 - changed.x0, changed.y1 - changed.y0);
+    }
+    try {
+        return [self makeImage:frame->pixels iccProfile:*dec->getIccProfile() error:error];
+    } catch (std::bad_alloc &err) {
+        NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JpegXLAnimatedDecoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    }
+}
+
+-(NSUInteger)droppedFrames {
+    return player ? static_cast<NSUInteger>(player->getDroppedFrames()) : 0;
+}
+
+-(NSUInteger)underruns {
+    return player ? static_cast<NSUInteger>(player->getUnderruns()) : 0;
+}
+
 -(NSUInteger)framesCount {
     return static_cast<NSUInteger>(dec->getNumberOfFrames());
 }
@@ -148,12 +452,37 @@ static void JXLDCGData8ProviderReleaseDataCallback(void *info, const void *data,
     return static_cast<int>(dec->getFrameDuration(frame));
 }
 
--(void)deinit {
+-(double)totalDuration {
+    return dec->getTotalDuration() / 1000.0;
+}
+
+-(int)frameAt:(double)seconds {
+    return dec->getFrameAt(seconds * 1000.0);
+}
+
+-(nullable JXLSystemImage *)seek:(double)seconds
+                            error:(NSError *_Nullable * _Nullable)error {
+    try {
+        JxlFrame jxlFrame = dec->seek(seconds * 1000.0);
+        return [self makeImage:jxlFrame error:error];
+    } catch (AnimatedDecoderError& err) {
+        NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JpegXLAnimatedDecoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    } catch (std::bad_alloc &err) {
+        NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JpegXLAnimatedDecoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    }
+}
+
+// No super call under ARC
+-(void)dealloc {
+    [self stopPlayback];
     if (dec) {
         delete dec;
         dec = nullptr;
     }
-    mSrc.clear();
 }
 
 @end
@@ -35,6 +35,30 @@
     effort:(int)effort
     quality:(int)quality error:(NSError * _Nullable *_Nullable)error;
 -(nullable void*)addFrame:(nonnull JXLSystemImage *)platformImage duration:(int)duration error:(NSError * _Nullable *_Nullable)error;
+/**
+ Queues the frame and returns while the previous ones are still encoding in background,
+ waits only when the queue is full. Errors of earlier frames are reported by the next call or by finish.
+ */
+-(nullable void*)enqueueFrame:(nonnull JXLSystemImage *)platformImage duration:(int)duration error:(NSError * _Nullable *_Nullable)error;
+/// Maximum number of frames waiting for encoding, 3 by default
+-(void)setQueueDepth:(NSUInteger)depth;
+-(NSUInteger)queueDepth;
+-(NSUInteger)peakQueueDepth;
+/// Number of times enqueueFrame waited for a free slot and total waiting time in seconds
+-(NSUInteger)queueStalls;
+-(double)queueStallTime;
+/**
+ Writes the image out while frames are being added so it never has to fit in memory.
+ Must be called before the first frame, finish then completes the stream and returns empty data.
+ Writes happen on the encoding thread. A file that can't be completed is removed, also when the
+ encoder is released without finish.
+ */
+-(nullable void*)streamToFile:(nonnull NSString*)path error:(NSError * _Nullable *_Nullable)error;
+/// File or socket, the descriptor stays owned by the caller, so are bytes written before an error
+-(nullable void*)streamToFileDescriptor:(int)fd error:(NSError * _Nullable *_Nullable)error;
+/// Handler returns NO to abort encoding, chunks delivered before an error don't form a valid image
+-(nullable void*)streamWithHandler:(BOOL (^_Nonnull)(NSData * _Nonnull chunk))handler error:(NSError * _Nullable *_Nullable)error;
+-(uint64_t)bytesWritten;
 -(nullable NSData*)finish:(NSError * _Nullable *_Nullable)error;
 @end
 
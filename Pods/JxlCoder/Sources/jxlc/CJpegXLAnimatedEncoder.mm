@@ -122,7 +122,128 @@ public:
     return reinterpret_cast<void*>(enc);
 }
 
+-(nullable void*)enqueueFrame:(nonnull JXLSystemImage *)platformImage duration:(int)duration error:(NSError * _Nullable *_Nullable)error {
+    try {
+        const int width = enc->getWidth();
+        const int height = enc->getHeight();
+        const CGSize size = [platformImage jxlPixelSize];
+        if (size.width != width || size.height != height) {
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500
+                                            userInfo:@{ NSLocalizedDescriptionKey: @"Width and height of all images must be equal" }];
+            return nil;
+        }
+        if (enc->getJxlPixelType() == rgb) {
+            std::vector<uint8_t> buf(static_cast<size_t>(width) * height * 4);
+            if (![platformImage jxlRenderRGBAPixels:buf.data() width:width height:height]) {
+                *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Cannot render image pixels" }];
+                return nil;
+            }
+            auto resizedVector = [RgbRgbaConverter convertRGBAtoRGB:buf width:width height:height];
+            if (resizedVector.size() == 1) {
+                *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Cannot convert RGBA pixels to RGB" }];
+                return nil;
+            }
+            enc->enqueueFrame(std::move(resizedVector), duration);
+        } else {
+            // Image is drawn straight into a pooled buffer recycled by the encoder, steady recording
+            // neither allocates nor copies frames
+            JxlFrameBuffer buffer = enc->acquireFrameBuffer();
+            if (buffer.size() != static_cast<size_t>(width) * height * 4
+                || ![platformImage jxlRenderRGBAPixels:buffer.data() width:width height:height]) {
+                *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Cannot render image pixels" }];
+                return nil;
+            }
+            enc->enqueueFrame(std::move(buffer), duration);
+        }
+    } catch (AnimatedEncoderError& err) {
+        NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    } catch (std::bad_alloc &err) {
+        NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    }
+    return reinterpret_cast<void*>(enc);
+}
+
+-(void)setQueueDepth:(NSUInteger)depth {
+    enc->setQueueDepth(depth);
+}
+
+-(NSUInteger)queueDepth {
+    return enc->getQueueStats().depth;
+}
+
+-(NSUInteger)peakQueueDepth {
+    return enc->getQueueStats().peakDepth;
+}
+
+-(NSUInteger)queueStalls {
+    return static_cast<NSUInteger>(enc->getQueueStats().stalls);
+}
+
+-(double)queueStallTime {
+    return enc->getQueueStats().stalledMs / 1000.0;
+}
+
+-(nullable void*)setOutputSink:(std::shared_ptr<JxlOutputSink>)sink error:(NSError * _Nullable *_Nullable)error {
+    try {
+        enc->setOutputSink(sink);
+    } catch (AnimatedEncoderError& err) {
+        NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    } catch (std::bad_alloc &err) {
+        NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    }
+    return reinterpret_cast<void*>(enc);
+}
+
+-(nullable void*)streamToFile:(nonnull NSString*)path error:(NSError * _Nullable *_Nullable)error {
+    auto sink = std::make_shared<JxlFileSink>(std::string([path UTF8String]));
+    if (!sink->isOpen()) {
+        NSString *str = [NSString stringWithFormat:@"Cannot open file for writing: %@", path];
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+        return nil;
+    }
+    return [self setOutputSink:sink error:error];
+}
+
+-(nullable void*)streamToFileDescriptor:(int)fd error:(NSError * _Nullable *_Nullable)error {
+    return [self setOutputSink:std::make_shared<JxlFileDescriptorSink>(fd) error:error];
+}
+
+-(nullable void*)streamWithHandler:(BOOL (^_Nonnull)(NSData * _Nonnull chunk))handler error:(NSError * _Nullable *_Nullable)error {
+    auto sink = std::make_shared<JxlCallbackSink>([handler](const uint8_t* data, size_t size) -> bool {
+        @autoreleasepool {
+            return handler([NSData dataWithBytes:data length:size]);
+        }
+    });
+    return [self setOutputSink:sink error:error];
+}
+
+-(uint64_t)bytesWritten {
+    return enc->getBytesWritten();
+}
+
 -(nullable NSData*)finish:(NSError * _Nullable *_Nullable)error {
+    if (enc->isStreaming()) {
+        try {
+            enc->finish();
+            return [NSData data];
+        } catch (AnimatedEncoderError& err) {
+            NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+            return nil;
+        } catch (std::bad_alloc &err) {
+            NSString *str = [[NSString alloc] initWithCString:err.what() encoding:NSUTF8StringEncoding];
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+            return nil;
+        }
+    }
     JCDataWrapper* wrapper = new JCDataWrapper;
     try {
         enc->encode(wrapper->data);
@@ -145,7 +266,8 @@ public:
     }
 }
 
--(void)deinit {
+// No super call under ARC, the encoder joins its worker and closes the output sink
+-(void)dealloc {
     if (enc) {
         delete enc;
         enc = nullptr;
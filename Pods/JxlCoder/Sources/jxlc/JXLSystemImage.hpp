@@ -44,6 +44,18 @@ typedef NS_ENUM(NSInteger, JXLColorSpace)  {
     kRGBA NS_SWIFT_NAME(rgba)
 };
 
+/// Color encoding stored in the file. The image's own keeps its pixels and ICC profile,
+/// others convert pixels into the named space and declare it without an ICC profile
+typedef NS_ENUM(NSInteger, JXLEncodingColorProfile) {
+    kColorProfileImage NS_SWIFT_NAME(image),
+    kColorProfileSRGB NS_SWIFT_NAME(srgb),
+    kColorProfileDisplayP3 NS_SWIFT_NAME(displayP3),
+    kColorProfileRec2020 NS_SWIFT_NAME(rec2020),
+    kColorProfileLinearSRGB NS_SWIFT_NAME(linearSRGB),
+    kColorProfileRec2100PQ NS_SWIFT_NAME(rec2100PQ),
+    kColorProfileRec2100HLG NS_SWIFT_NAME(rec2100HLG)
+};
+
 typedef NS_ENUM(NSInteger, JXLCompressionOption) {
     kLoseless NS_SWIFT_NAME(loseless),
     kLossy NS_SWIFT_NAME(lossy)
@@ -55,6 +67,11 @@ typedef NS_ENUM(NSInteger, JXLPreferredPixelFormat) {
     kFloat16 NS_SWIFT_NAME(float16),
 };
 
+typedef NS_ENUM(NSInteger, JXLQualityTarget) {
+    kTargetSSIM NS_SWIFT_NAME(ssim),
+    kTargetSize NS_SWIFT_NAME(size)
+};
+
 typedef NS_ENUM(NSInteger, JxlSampler)  {
     kNearestNeighbor NS_SWIFT_NAME(nearestNeighbor),
     kBilinear NS_SWIFT_NAME(bilinear),
@@ -69,6 +86,18 @@ typedef NS_ENUM(NSInteger, JxlSampler)  {
 
 @interface JXLSystemImage (JXLColorData)
 - (nullable uint8_t*)jxlRGBAPixels:(nonnull size_t*)bufferSize width:(nonnull int*)xSize height:(nonnull int*)ySize;
+/// Size of the underlying bitmap, which may differ from the image size in points
+- (CGSize)jxlPixelSize;
+/// Same pixels rendered into caller's memory of xSize * ySize * 4 bytes, false when the image has a different pixel size
+- (bool)jxlRenderRGBAPixels:(nonnull uint8_t*)pixels width:(int)xSize height:(int)ySize;
+/// Pixels converted into colorSpace, unpremultiplied unless premultiplied is requested
+- (nullable uint8_t*)jxlRGBAPixels:(nonnull size_t*)bufferSize width:(nonnull int*)xSize height:(nonnull int*)ySize
+                      inColorSpace:(nonnull CGColorSpaceRef)colorSpace premultiplied:(bool)premultiplied;
+/// Renders pixels in the image's own RGB color space instead of converting them to sRGB.
+/// `iccProfile` receives the profile of the pixels, or nil when they are sRGB.
+/// Premultiplied pixels are returned as rendered, without unpremultiply pass.
+- (nullable uint8_t*)jxlRGBAPixels:(nonnull size_t*)bufferSize width:(nonnull int*)xSize height:(nonnull int*)ySize
+                        iccProfile:(NSData * _Nullable * _Nonnull)iccProfile premultiplied:(bool)premultiplied;
 @end
 
 #endif /* JXLSystemImage_h */
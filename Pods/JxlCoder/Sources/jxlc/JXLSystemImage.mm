@@ -58,20 +58,15 @@
     return imageRef;
 }
 
-- (nullable uint8_t*)jxlRGBAPixels:(nonnull size_t*)bufferSize width:(nonnull int*)xSize height:(nonnull int*)ySize {
-    CGImageRef imageRef = [self makeCGImage];
-    NSUInteger width = CGImageGetWidth(imageRef);
-    NSUInteger height = CGImageGetHeight(imageRef);
+-(bool)jxlDrawRGBAPixels:(nonnull uint8_t*)targetMemory width:(NSUInteger)width height:(NSUInteger)height
+            inColorSpace:(nonnull CGColorSpaceRef)colorSpace {
     int stride = (int)4 * (int)width * sizeof(uint8_t);
-    uint8_t *targetMemory = reinterpret_cast<uint8_t*>(malloc((int)(stride * height)));
-    *bufferSize = (size_t)(stride * height);
-    *xSize = (int)width;
-    *ySize = (int)height;
-
-    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
     CGBitmapInfo bitmapInfo = (int)kCGImageAlphaPremultipliedLast | (int)kCGImageByteOrderDefault;
 
     CGContextRef targetContext = CGBitmapContextCreate(targetMemory, width, height, 8, stride, colorSpace, bitmapInfo);
+    if (!targetContext) {
+        return false;
+    }
 
     [NSGraphicsContext saveGraphicsState];
     [NSGraphicsContext setCurrentContext: [NSGraphicsContext graphicsContextWithCGContext:targetContext flipped:FALSE]];
@@ -84,40 +79,99 @@
     [NSGraphicsContext restoreGraphicsState];
 
     CGContextRelease(targetContext);
-    CGColorSpaceRelease(colorSpace);
+    return true;
+}
+#else
+-(nullable CGImageRef)makeCGImage {
+    return [self CGImage];
+}
 
-    if (![self unpremultiply:targetMemory width:width height:height]) {
-        free(targetMemory);
-        return nil;
+-(bool)jxlDrawRGBAPixels:(nonnull uint8_t*)rawData width:(NSUInteger)width height:(NSUInteger)height
+            inColorSpace:(nonnull CGColorSpaceRef)colorSpace {
+    NSUInteger bytesPerPixel = 4;
+    NSUInteger bytesPerRow = bytesPerPixel * width;
+    NSUInteger bitsPerComponent = 8;
+    CGContextRef context = CGBitmapContextCreate(rawData, width, height,
+                                                 bitsPerComponent, bytesPerRow, colorSpace,
+                                                 (int)kCGImageAlphaPremultipliedLast | (int)kCGBitmapByteOrder32Big);
+    if (!context) {
+        return false;
     }
 
-    return targetMemory;
+    CGContextDrawImage(context, CGRectMake(0, 0, width, height), [self CGImage]);
+    CGContextRelease(context);
+    return true;
 }
-#else
+#endif
+
+- (CGSize)jxlPixelSize {
+    CGImageRef imageRef = [self makeCGImage];
+    return CGSizeMake(CGImageGetWidth(imageRef), CGImageGetHeight(imageRef));
+}
+
 - (nullable uint8_t*)jxlRGBAPixels:(nonnull size_t*)bufferSize width:(nonnull int*)xSize height:(nonnull int*)ySize {
-    CGImageRef imageRef = [self CGImage];
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    auto pixels = [self jxlRGBAPixels:bufferSize width:xSize height:ySize inColorSpace:colorSpace premultiplied:false];
+    CGColorSpaceRelease(colorSpace);
+    return pixels;
+}
+
+- (nullable uint8_t*)jxlRGBAPixels:(nonnull size_t*)bufferSize width:(nonnull int*)xSize height:(nonnull int*)ySize
+                      inColorSpace:(nonnull CGColorSpaceRef)colorSpace premultiplied:(bool)premultiplied {
+    CGImageRef imageRef = [self makeCGImage];
     NSUInteger width = CGImageGetWidth(imageRef);
     NSUInteger height = CGImageGetHeight(imageRef);
-    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
-    unsigned char *rawData = (unsigned char*) malloc(height * width * 4 * sizeof(uint8_t));
+    uint8_t *targetMemory = reinterpret_cast<uint8_t*>(malloc(height * width * 4 * sizeof(uint8_t)));
+    if (!targetMemory) {
+        return nil;
+    }
     *bufferSize = height * width * 4 * sizeof(uint8_t);
     *xSize = (int)width;
     *ySize = (int)height;
-    NSUInteger bytesPerPixel = 4;
-    NSUInteger bytesPerRow = bytesPerPixel * width;
-    NSUInteger bitsPerComponent = 8;
-    CGContextRef context = CGBitmapContextCreate(rawData, width, height,
-                                                 bitsPerComponent, bytesPerRow, colorSpace,
-                                                 (int)kCGImageAlphaPremultipliedLast | (int)kCGBitmapByteOrder32Big);
-
-    CGContextDrawImage(context, CGRectMake(0, 0, width, height), imageRef);
 
-    if (![self unpremultiply:rawData width:width height:height]) {
-        free(rawData);
+    if (![self jxlDrawRGBAPixels:targetMemory width:width height:height inColorSpace:colorSpace]
+        || (!premultiplied && ![self unpremultiply:targetMemory width:width height:height])) {
+        free(targetMemory);
         return nil;
     }
 
-    return rawData;
+    return targetMemory;
+}
+
+- (bool)jxlRenderRGBAPixels:(nonnull uint8_t*)pixels width:(int)xSize height:(int)ySize {
+    CGImageRef imageRef = [self makeCGImage];
+    if (!imageRef || CGImageGetWidth(imageRef) != static_cast<size_t>(xSize)
+        || CGImageGetHeight(imageRef) != static_cast<size_t>(ySize)) {
+        return false;
+    }
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    bool rendered = [self jxlDrawRGBAPixels:pixels width:xSize height:ySize inColorSpace:colorSpace]
+                    && [self unpremultiply:pixels width:xSize height:ySize];
+    CGColorSpaceRelease(colorSpace);
+    return rendered;
+}
+
+- (nullable uint8_t*)jxlRGBAPixels:(nonnull size_t*)bufferSize width:(nonnull int*)xSize height:(nonnull int*)ySize
+                        iccProfile:(NSData * _Nullable * _Nonnull)iccProfile premultiplied:(bool)premultiplied {
+    *iccProfile = nil;
+    CGColorSpaceRef colorSpace = CGImageGetColorSpace([self makeCGImage]);
+    bool keepColorSpace = colorSpace && CGColorSpaceGetModel(colorSpace) == kCGColorSpaceModelRGB;
+    if (keepColorSpace) {
+        CFStringRef name = CGColorSpaceGetName(colorSpace);
+        keepColorSpace = !(name && CFEqual(name, kCGColorSpaceSRGB));
+    }
+    NSData* icc = keepColorSpace ? (__bridge_transfer NSData*)CGColorSpaceCopyICCData(colorSpace) : nil;
+    if (!icc) {
+        CGColorSpaceRef deviceColorSpace = CGColorSpaceCreateDeviceRGB();
+        auto pixels = [self jxlRGBAPixels:bufferSize width:xSize height:ySize
+                             inColorSpace:deviceColorSpace premultiplied:premultiplied];
+        CGColorSpaceRelease(deviceColorSpace);
+        return pixels;
+    }
+    auto pixels = [self jxlRGBAPixels:bufferSize width:xSize height:ySize inColorSpace:colorSpace premultiplied:premultiplied];
+    if (pixels) {
+        *iccProfile = icc;
+    }
+    return pixels;
 }
-#endif
 @end
@@ -24,86 +24,187 @@
 //
 
 #include "JxlAnimatedDecoder.hpp"
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
-JxlFrame JxlAnimatedDecoder::getFrame(int framePosition) {
-    std::lock_guard guard(lock);
-    if (framePosition < 0) {
-        std::string str = "Frame position must be positive";
-        throw AnimatedDecoderError(str);
+bool JxlAnimatedDecoder::ensureIndexed(size_t frames) {
+    if (!indexComplete.load(std::memory_order_acquire) && index.frames.size() < frames) {
+        // Broken tail leaves the animation truncated to the frames scanned so far
+        if (!scanner->scan(frames) || scanner->isComplete()) {
+            indexComplete.store(true, std::memory_order_release);
+        }
     }
+    return index.frames.size() >= frames;
+}
 
-    if (framePosition >= this->frameInfo.size()) {
-        std::string str = "Requested frame index more than frames in the container";
-        throw AnimatedDecoderError(str);
+int JxlAnimatedDecoder::getNumberOfFrames() {
+    if (!indexComplete.load(std::memory_order_acquire)) {
+        std::lock_guard guard(indexLock);
+        ensureIndexed(SIZE_MAX);
+    }
+    return static_cast<int>(index.frames.size());
+}
+
+int JxlAnimatedDecoder::getFrameDuration(int frame) {
+    if (frame < 0) {
+        return 0;
+    }
+    if (indexComplete.load(std::memory_order_acquire)) {
+        return static_cast<size_t>(frame) < index.frames.size() ? index.frames[frame].duration : 0;
+    }
+    std::lock_guard guard(indexLock);
+    return ensureIndexed(frame + 1) ? index.frames[frame].duration : 0;
+}
+
+bool JxlAnimatedDecoder::isKeyframe(int frame) {
+    if (frame < 0) {
+        return false;
     }
+    if (indexComplete.load(std::memory_order_acquire)) {
+        return static_cast<size_t>(frame) < index.frames.size() ? index.frames[frame].keyframe : false;
+    }
+    std::lock_guard guard(indexLock);
+    return ensureIndexed(frame + 1) ? index.frames[frame].keyframe : false;
+}
+
+const JxlFrameIndex& JxlAnimatedDecoder::getFrameIndex() {
+    getNumberOfFrames();
+    return index;
+}
 
-    JxlDecoderRewind(dec.get());
-    if (JXL_DEC_SUCCESS != JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_FULL_IMAGE | JXL_DEC_FRAME)) {
+double JxlAnimatedDecoder::getTotalDuration() {
+    getNumberOfFrames();
+    if (index.frames.empty() || !info.have_animation || numer == 0) {
+        return 0;
+    }
+    const JxlFrameIndexEntry& last = index.frames.back();
+    return 1000.0 * static_cast<double>(last.startTicks + last.ticks) * denom / numer;
+}
+
+int JxlAnimatedDecoder::getFrameAt(double time) {
+    if (!info.have_animation || numer == 0 || !(time > 0)) {
+        return 0;
+    }
+    uint64_t ticks = static_cast<uint64_t>(std::min(time * numer / (1000.0 * denom), 1e18));
+
+    std::unique_lock<std::mutex> indexGuard(indexLock, std::defer_lock);
+    if (!indexComplete.load(std::memory_order_acquire)) {
+        indexGuard.lock();
+    }
+    // Table is extended only until it covers the time, or to the end when time is past the first loop
+    while (!indexComplete.load(std::memory_order_acquire)
+           && (index.frames.empty() || ticks >= index.frames.back().startTicks + index.frames.back().ticks)) {
+        ensureIndexed(index.frames.size() + indexStep);
+    }
+    if (index.frames.empty()) {
+        return 0;
+    }
+
+    const int lastFrame = static_cast<int>(index.frames.size()) - 1;
+    const uint64_t total = index.frames.back().startTicks + index.frames.back().ticks;
+    if (ticks >= total) {
+        if (total == 0 || (loopCount > 0 && ticks / total >= static_cast<uint64_t>(loopCount))) {
+            return lastFrame;
+        }
+        ticks %= total;
+    }
+
+    // Last frame started at or before the time, zero duration frames are never on screen
+    auto frame = std::upper_bound(index.frames.begin(), index.frames.end(), ticks,
+                                  [](uint64_t t, const JxlFrameIndexEntry& entry) {
+        return t < entry.startTicks;
+    });
+    return static_cast<int>(frame - index.frames.begin()) - 1;
+}
+
+JxlFrame JxlAnimatedDecoder::seek(double time) {
+    return getFrame(getFrameAt(time));
+}
+
+void JxlAnimatedDecoder::indexInBackground() {
+    // Concurrent callers must not both start the worker, the loser would overwrite a joinable thread
+    std::lock_guard indexGuard(indexLock);
+    if (indexComplete.load(std::memory_order_acquire) || indexWorker.joinable()) {
+        return;
+    }
+    indexWorker = std::thread([this] {
+        // Small steps so decoding, which needs the same lock, isn't held back
+        while (!stopIndexing.load()) {
+            std::lock_guard guard(indexLock);
+            if (indexComplete.load(std::memory_order_acquire)) {
+                break;
+            }
+            ensureIndexed(index.frames.size() + indexStep);
+        }
+    });
+}
+
+void JxlAnimatedDecoder::rewind(DecodingInstance& instance) {
+    JxlDecoder* dec = instance.dec.get();
+    JxlDecoderRewind(dec);
+    // Own compositing needs every layer in full, only coalesced frames can stop at their DC
+    int events = JXL_DEC_FULL_IMAGE | JXL_DEC_FRAME | (instance.compositor ? 0 : JXL_DEC_FRAME_PROGRESSION);
+    if (JXL_DEC_SUCCESS != JxlDecoderSubscribeEvents(dec, events)) {
         std::string str = "Cannot subscribe to events";
         throw AnimatedDecoderError(str);
     }
-    if (JXL_DEC_SUCCESS != JxlDecoderSetInput(dec.get(), data.data(), data.size())) {
+    if (JXL_DEC_SUCCESS != JxlDecoderSetInput(dec, input->data(), input->size())) {
         std::string str = "Set input has failed";
         throw AnimatedDecoderError(str);
     }
-    JxlDecoderCloseInput(dec.get());
-    JxlDecoderSkipFrames(dec.get(), framePosition);
-    
-    if (JXL_DEC_SUCCESS != JxlDecoderSetCoalescing(dec.get(), JXL_FALSE)) {
-        std::string str = "Cannot coalesce frames";
-        throw AnimatedDecoderError(str);
+    JxlDecoderCloseInput(dec);
+    instance.position = 0;
+    instance.layerPosition = 0;
+    if (instance.compositor) {
+        instance.compositor->reset();
     }
+}
 
-    int frameTime = 0;
-    std::vector<uint8_t> pixels;
+void JxlAnimatedDecoder::seekLayer(DecodingInstance& instance, size_t layer) {
+    if (layer < instance.layerPosition) {
+        rewind(instance);
+    }
+    if (layer > instance.layerPosition) {
+        JxlDecoderSkipFrames(instance.dec.get(), layer - instance.layerPosition);
+        instance.layerPosition = layer;
+    }
+}
+
+void JxlAnimatedDecoder::decodeLayer(DecodingInstance& instance, const JxlIndexedLayer& layer) {
+    JxlDecoder* dec = instance.dec.get();
+    std::vector<uint8_t>& layerPixels = instance.layerPixels;
     JxlPixelFormat format = {4, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0};
     for (;;) {
-        JxlDecoderStatus status = JxlDecoderProcessInput(dec.get());
+        JxlDecoderStatus status = JxlDecoderProcessInput(dec);
         if (status == JXL_DEC_FRAME) {
-            JxlFrameHeader header;
-            if (JXL_DEC_SUCCESS != JxlDecoderGetFrameHeader(dec.get(), &header)) {
-                std::string str = "Cannot retreive frame header info";
-                throw AnimatedDecoderError(str);
-            }
-            JxlAnimationHeader animation = info.animation;
-            if (animation.tps_numerator)
-                frameTime = (int)(1000.0 * header.duration * animation.tps_denominator / animation.tps_numerator);
-            else
-                frameTime = 0;
+            continue;
         } else if (status == JXL_DEC_NEED_IMAGE_OUT_BUFFER) {
             size_t bufferSize;
-            int components = 4;
             if (JXL_DEC_SUCCESS !=
-                JxlDecoderImageOutBufferSize(dec.get(), &format, &bufferSize)) {
+                JxlDecoderImageOutBufferSize(dec, &format, &bufferSize)) {
                 std::string str = "Cannot retreive buffer info size";
                 throw AnimatedDecoderError(str);
             }
-            if (bufferSize != info.xsize * info.ysize * (components) * sizeof(uint8_t)) {
-                std::string str = "Cannot retreive buffer info size";
+            if (bufferSize != static_cast<size_t>(layer.xsize) * layer.ysize * 4 * sizeof(uint8_t)) {
+                std::string str = "Layer size doesn't match frames index";
                 throw AnimatedDecoderError(str);
             }
-            pixels.resize(info.xsize * info.ysize * (components) * sizeof(uint8_t));
-            void *pixelsBuffer = (void *) pixels.data();
-
-            if (JXL_DEC_SUCCESS != JxlDecoderSetImageOutBuffer(dec.get(),
+            layerPixels.resize(bufferSize);
+            if (JXL_DEC_SUCCESS != JxlDecoderSetImageOutBuffer(dec,
                                                                &format,
-                                                               pixelsBuffer,
-                                                               pixels.size())) {
+                                                               layerPixels.data(),
+                                                               layerPixels.size())) {
                 std::string str = "Cannot decoder buffer info";
                 throw AnimatedDecoderError(str);
             }
-        } else if (status == JXL_DEC_FULL_IMAGE || status == JXL_DEC_SUCCESS) {
-            // All decoding successfully finished, we are at the end of the file.
-            // We must rewind the decoder to get a new frame.
-            JxlDecoderRewind(dec.get());
-            JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_FRAME | JXL_DEC_FULL_IMAGE);
-            JxlDecoderSetInput(dec.get(), data.data(), data.size());
-            JxlDecoderCloseInput(dec.get());
-
-            std::vector<uint8_t> iccCopy;
-            iccCopy = iccProfile;
-            JxlFrame frame = { .duration = frameTime, .pixels = pixels, .iccProfile = iccCopy };
-            return frame;
+        } else if (status == JXL_DEC_FULL_IMAGE) {
+            instance.layerPosition += 1;
+            return;
+        } else if (status == JXL_DEC_SUCCESS) {
+            std::string str = "Frame is missing in the container";
+            throw AnimatedDecoderError(str);
         } else {
             std::string str = "Error event has received";
             throw AnimatedDecoderError(str);
@@ -111,60 +212,605 @@ JxlFrame JxlAnimatedDecoder::getFrame(int framePosition) {
     }
 }
 
-JxlFrame JxlAnimatedDecoder::nextFrame() {
-    std::lock_guard guard(lock);
-    int frameTime = 0;
-    for (;;) {
-        JxlDecoderStatus status = JxlDecoderProcessInput(dec.get());
-        if (status == JXL_DEC_FULL_IMAGE || status == JXL_DEC_SUCCESS) {
-            // All decoding successfully finished, we are at the end of the file.
-            // We must rewind the decoder to get a new frame.
-            JxlDecoderRewind(dec.get());
-            JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_FRAME | JXL_DEC_FULL_IMAGE);
-            JxlDecoderSetInput(dec.get(), data.data(), data.size());
-            JxlDecoderCloseInput(dec.get());
-        } else if (status == JXL_DEC_FRAME) {
-            JxlFrameHeader header;
-            if (JXL_DEC_SUCCESS != JxlDecoderGetFrameHeader(dec.get(), &header)) {
-                std::string str = "Cannot retreive frame header info";
-                throw AnimatedDecoderError(str);
+void JxlAnimatedDecoder::composeFrame(DecodingInstance& instance, int framePosition, std::vector<uint8_t>& pixels,
+                                      int filled) {
+    JxlFrameCompositor* compositor = instance.compositor.get();
+    const JxlFrameIndexEntry& target = index.frames[framePosition];
+    // Current canvas is usable only when nothing the target depends on was skipped
+    if (framePosition < instance.position || target.dependsOn > instance.position) {
+        std::lock_guard guard(checkpointsLock);
+        int start = target.dependsOn;
+        auto checkpoint = checkpoints.end();
+        auto nearest = checkpoints.upper_bound(framePosition - 1);
+        if (nearest != checkpoints.begin()) {
+            --nearest;
+            if (nearest->first + 1 >= target.dependsOn) {
+                checkpoint = nearest;
+                start = nearest->first + 1;
+            }
+        }
+        seekLayer(instance, index.frames[start].firstLayer);
+        if (checkpoint != checkpoints.end()) {
+            compositor->restore(checkpoint->second);
+        } else {
+            compositor->reset();
+        }
+        instance.position = start;
+    }
+
+    try {
+        for (; instance.position <= framePosition; ++instance.position) {
+            const int position = instance.position;
+            const JxlFrameIndexEntry& frame = index.frames[position];
+            seekLayer(instance, frame.firstLayer);
+            for (size_t i = 0; i < frame.layersCount; ++i) {
+                const JxlIndexedLayer& layer = index.layers[frame.firstLayer + i];
+                decodeLayer(instance, layer);
+                compositor->compose(layer, instance.layerPixels.data());
+            }
+            if (position > 0 && position % minCheckpointSpacing == 0) {
+                saveCheckpoint(*compositor, position);
             }
-            JxlAnimationHeader animation = info.animation;
-            if (animation.tps_numerator)
-                frameTime = (int)(1000.0 * header.duration * animation.tps_denominator / animation.tps_numerator);
-            else
-                frameTime = 0;
+        }
+    } catch (AnimatedDecoderError& err) {
+        rewind(instance);
+        throw;
+    }
+
+    const std::vector<uint8_t>& canvas = compositor->getCanvas();
+    if (filled < 0 || filled >= framePosition || pixels.size() != canvas.size()) {
+        pixels.assign(canvas.begin(), canvas.end());
+        return;
+    }
+    // Buffer already holds frame filled, only what changed since then is copied from the canvas
+    const JxlCanvasRect full = { 0, 0, info.xsize, info.ysize };
+    JxlCanvasRect area;
+    for (int i = filled + 1; i <= framePosition; ++i) {
+        area.unite(changedRect(i));
+        if (area.x0 == 0 && area.y0 == 0 && area.x1 == full.x1 && area.y1 == full.y1) {
+            break;
+        }
+    }
+    if (area.empty()) {
+        return;
+    }
+    const size_t rowLength = (area.x1 - area.x0) * 4;
+    for (uint32_t y = area.y0; y < area.y1; ++y) {
+        const size_t offset = (static_cast<size_t>(y) * info.xsize + area.x0) * 4;
+        memcpy(pixels.data() + offset, canvas.data() + offset, rowLength);
+    }
+}
+
+void JxlAnimatedDecoder::respaceCheckpoints(int spacing) {
+    checkpointSpacing = spacing;
+    for (auto it = checkpoints.begin(); it != checkpoints.end();) {
+        if (it->first % spacing != 0) {
+            checkpointBytes -= it->second.size();
+            it = checkpoints.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void JxlAnimatedDecoder::saveCheckpoint(const JxlFrameCompositor& compositor, int position) {
+    // At most maxCheckpoints over the frames scanned so far, while the table grows the spacing
+    // doubles and drops every other checkpoint, so frames past the start still get their share
+    int spacing = minCheckpointSpacing;
+    while (static_cast<int>(index.frames.size()) / spacing > maxCheckpoints) {
+        spacing *= 2;
+    }
+    {
+        std::lock_guard guard(checkpointsLock);
+        spacing = std::max(spacing, budgetSpacing);
+        if (spacing != checkpointSpacing) {
+            respaceCheckpoints(spacing);
+        }
+        if (position % spacing != 0 || checkpoints.find(position) != checkpoints.end()) {
+            return;
+        }
+    }
+
+    // Slots no later layer blends onto are not kept, unknown until the table is complete
+    uint32_t usedSlots = 0xF;
+    if (indexComplete.load(std::memory_order_acquire)) {
+        usedSlots = 0;
+        const size_t next = static_cast<size_t>(position) + 1;
+        const size_t firstLayer = next < index.frames.size() ? index.frames[next].firstLayer : index.layers.size();
+        for (size_t i = firstLayer; i < index.layers.size() && usedSlots != 0xF; ++i) {
+            usedSlots |= 1u << (index.layers[i].blendSource & 3);
+        }
+    }
+
+    JxlFrameCompositor::Checkpoint checkpoint;
+    compositor.save(&checkpoint, usedSlots);
+    const size_t size = checkpoint.size();
+
+    std::lock_guard guard(checkpointsLock);
+    if (size > checkpointBudget || checkpoints.find(position) != checkpoints.end()) {
+        return;
+    }
+    while (checkpointBytes + size > checkpointBudget) {
+        budgetSpacing = checkpointSpacing * 2;
+        respaceCheckpoints(budgetSpacing);
+        if (position % checkpointSpacing != 0) {
+            return;
+        }
+    }
+    checkpointBytes += size;
+    checkpoints[position] = std::move(checkpoint);
+}
+
+void JxlAnimatedDecoder::toneMapRows(void* opaque, size_t x, size_t y, size_t count, const void* pixels) {
+    auto target = static_cast<ToneMappingTarget*>(opaque);
+    target->mapper->mapRow(static_cast<const float*>(pixels), target->pixels + y * target->stride + x * 4, count);
+}
+
+bool JxlAnimatedDecoder::layersComposable(size_t end) {
+    size_t checked = composableLayers.load();
+    for (; checked < end; ++checked) {
+        if (!index.layers[checked].composable) {
+            return false;
+        }
+    }
+    size_t previous = composableLayers.load();
+    while (previous < checked && !composableLayers.compare_exchange_weak(previous, checked)) {
+    }
+    return true;
+}
+
+bool JxlAnimatedDecoder::decodeFrame(DecodingInstance& instance, int framePosition,
+                                     std::vector<uint8_t>& pixels, bool reduced, int filled) {
+    if (incremental.load(std::memory_order_acquire)) {
+        const JxlFrameIndexEntry& frame = index.frames[framePosition];
+        if (layersComposable(frame.firstLayer + frame.layersCount)) {
+            composeFrame(instance, framePosition, pixels, filled);
+            return false;
+        }
+        incremental.store(false, std::memory_order_release);
+    }
+
+    JxlDecoder* dec = instance.dec.get();
+    if (instance.compositor) {
+        // Switches to coalescing, which libjxl accepts only before the input is processed
+        instance.compositor.reset();
+        JxlDecoderRewind(dec);
+        if (JXL_DEC_SUCCESS != JxlDecoderSetCoalescing(dec, JXL_TRUE)) {
+            std::string str = "Cannot coalesce frames";
+            throw AnimatedDecoderError(str);
+        }
+        rewind(instance);
+    }
+
+    // Moving forward continues from the current position, only going back requires a rewind.
+    // libjxl keeps frame dependencies across rewinds, so skipped frames are decoded only
+    // when they are referenced, starting from the nearest independent frame.
+    if (framePosition < instance.position) {
+        rewind(instance);
+    }
+    if (framePosition > instance.position) {
+        JxlDecoderSkipFrames(dec, framePosition - instance.position);
+        instance.position = framePosition;
+    }
+
+    JxlDataType dataType = JXL_TYPE_UINT8;
+    if (pixelFormat == float16) {
+        dataType = JXL_TYPE_FLOAT16;
+    } else if (pixelFormat == u16) {
+        dataType = JXL_TYPE_UINT16;
+    }
+    JxlPixelFormat format = {4, dataType, JXL_NATIVE_ENDIAN, 0};
+    for (;;) {
+        JxlDecoderStatus status = JxlDecoderProcessInput(dec);
+        if (status == JXL_DEC_FRAME) {
+            continue;
         } else if (status == JXL_DEC_NEED_IMAGE_OUT_BUFFER) {
             size_t bufferSize;
-            JxlPixelFormat format = {4, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0};
             int components = 4;
             if (JXL_DEC_SUCCESS !=
-                JxlDecoderImageOutBufferSize(dec.get(), &format, &bufferSize)) {
+                JxlDecoderImageOutBufferSize(dec, &format, &bufferSize)) {
                 std::string str = "Cannot retreive buffer info size";
                 throw AnimatedDecoderError(str);
             }
-            if (bufferSize != info.xsize * info.ysize * (components) * sizeof(uint8_t)) {
+            if (bufferSize != info.xsize * info.ysize * (components) * bytesPerSample) {
                 std::string str = "Cannot retreive buffer info size";
                 throw AnimatedDecoderError(str);
             }
-            std::vector<uint8_t> pixels;
-            pixels.resize(info.xsize * info.ysize * (components) * sizeof(uint8_t));
+            pixels.resize(info.xsize * info.ysize * (components) * bytesPerSample);
+
+            if (toneMapper) {
+                // Float rows are mapped to 8-bit as they are produced, no float frame is kept
+                JxlPixelFormat floatFormat = {4, JXL_TYPE_FLOAT, JXL_NATIVE_ENDIAN, 0};
+                instance.toneMapping = { toneMapper.get(), pixels.data(), static_cast<size_t>(info.xsize) * 4 };
+                if (JXL_DEC_SUCCESS != JxlDecoderSetImageOutCallback(dec, &floatFormat, toneMapRows,
+                                                                     &instance.toneMapping)) {
+                    std::string str = "Cannot set tone mapping output";
+                    throw AnimatedDecoderError(str);
+                }
+                continue;
+            }
+
             void *pixelsBuffer = (void *) pixels.data();
 
-            if (JXL_DEC_SUCCESS != JxlDecoderSetImageOutBuffer(dec.get(),
+            if (JXL_DEC_SUCCESS != JxlDecoderSetImageOutBuffer(dec,
                                                                &format,
                                                                pixelsBuffer,
                                                                pixels.size())) {
                 std::string str = "Cannot decoder buffer info";
                 throw AnimatedDecoderError(str);
             }
-            std::vector<uint8_t> iccCopy;
-            iccCopy = iccProfile;
-            JxlFrame frame = { .duration = frameTime, .pixels = pixels, .iccProfile = iccCopy };
-            return frame;
+        } else if (status == JXL_DEC_FRAME_PROGRESSION) {
+            // Upsampled DC is flushed and the rest of the frame is never decoded,
+            // when the flush isn't available the frame is decoded in full
+            if (reduced && JXL_DEC_SUCCESS == JxlDecoderFlushImage(dec)
+                && JXL_DEC_SUCCESS == JxlDecoderSkipCurrentFrame(dec)) {
+                instance.position = framePosition + 1;
+                return true;
+            }
+        } else if (status == JXL_DEC_FULL_IMAGE) {
+            instance.position = framePosition + 1;
+            return false;
+        } else if (status == JXL_DEC_SUCCESS) {
+            rewind(instance);
+            std::string str = "Frame is missing in the container";
+            throw AnimatedDecoderError(str);
         } else {
+            rewind(instance);
             std::string str = "Error event has received";
             throw AnimatedDecoderError(str);
         }
     }
 }
+
+JxlFrame JxlAnimatedDecoder::getFrame(int framePosition, int shown) {
+    JxlFrame frame = { .pixels = pool->acquire(), .iccProfile = iccProfile, .duration = 0,
+                       .width = static_cast<int>(info.xsize), .height = static_cast<int>(info.ysize), .changed = {} };
+    frame.duration = getFrame(framePosition, frame.pixels.storage(), -1, &frame.lossy);
+    frame.changed = shown >= 0 && framePosition == shown + 1
+                    ? getChangedRect(framePosition)
+                    : JxlCanvasRect{ 0, 0, info.xsize, info.ysize };
+    return frame;
+}
+
+JxlFrame JxlAnimatedDecoder::getFrameRegion(int framePosition, int shown) {
+    JxlFrame frame = getFrame(framePosition, shown);
+    const JxlCanvasRect& rect = frame.changed;
+    std::vector<uint8_t>& pixels = frame.pixels.storage();
+    if (rect.empty()) {
+        frame.width = 0;
+        frame.height = 0;
+        pixels.clear();
+        return frame;
+    }
+    // Rows of the area are moved to the front of the same buffer, pixels are never copied elsewhere
+    const size_t pixelSize = 4 * bytesPerSample;
+    const size_t rowLength = (rect.x1 - rect.x0) * pixelSize;
+    for (uint32_t y = rect.y0; y < rect.y1; ++y) {
+        memmove(pixels.data() + (y - rect.y0) * rowLength,
+                pixels.data() + (static_cast<size_t>(y) * info.xsize + rect.x0) * pixelSize, rowLength);
+    }
+    pixels.resize(rowLength * (rect.y1 - rect.y0));
+    frame.width = static_cast<int>(rect.x1 - rect.x0);
+    frame.height = static_cast<int>(rect.y1 - rect.y0);
+    return frame;
+}
+
+JxlCanvasRect JxlAnimatedDecoder::getChangedRect(int frame) {
+    if (frame < 0) {
+        return {};
+    }
+    std::unique_lock<std::mutex> indexGuard(indexLock, std::defer_lock);
+    if (!indexComplete.load(std::memory_order_acquire)) {
+        indexGuard.lock();
+    }
+    return ensureIndexed(frame + 1) ? changedRect(frame) : JxlCanvasRect();
+}
+
+JxlCanvasRect JxlAnimatedDecoder::changedRect(int framePosition) {
+    const JxlCanvasRect canvas = { 0, 0, info.xsize, info.ysize };
+    if (framePosition == 0) {
+        return canvas;
+    }
+    const JxlFrameIndexEntry& previous = index.frames[framePosition - 1];
+    const JxlIndexedLayer& previousLast = index.layers[previous.firstLayer + previous.layersCount - 1];
+    if (!previousLast.saved) {
+        return canvas;
+    }
+
+    // Outside of the layers the canvas is the background slot, which holds the previous frame
+    // only when that frame was saved there and every layer of this one keeps building on it
+    const uint32_t slot = previousLast.saveAsReference;
+    const JxlFrameIndexEntry& frame = index.frames[framePosition];
+    JxlCanvasRect changed;
+    for (size_t i = 0; i < frame.layersCount; ++i) {
+        const JxlIndexedLayer& layer = index.layers[frame.firstLayer + i];
+        const bool last = i + 1 == frame.layersCount;
+        if (layer.blendSource != slot || (!last && (!layer.saved || layer.saveAsReference != slot))) {
+            return canvas;
+        }
+        const int64_t x0 = std::max<int64_t>(layer.cropX0, 0);
+        const int64_t y0 = std::max<int64_t>(layer.cropY0, 0);
+        const int64_t x1 = std::min<int64_t>(static_cast<int64_t>(layer.cropX0) + layer.xsize, info.xsize);
+        const int64_t y1 = std::min<int64_t>(static_cast<int64_t>(layer.cropY0) + layer.ysize, info.ysize);
+        if (x0 < x1 && y0 < y1) {
+            changed.unite({ static_cast<uint32_t>(x0), static_cast<uint32_t>(y0),
+                            static_cast<uint32_t>(x1), static_cast<uint32_t>(y1) });
+        }
+    }
+    return changed;
+}
+
+JxlFrame JxlAnimatedDecoder::getFrame(int framePosition, int width, int height, XSampler sampler, int shown) {
+    if (width <= 0 || height <= 0) {
+        std::string str = "Output size must be positive";
+        throw AnimatedDecoderError(str);
+    }
+    if (static_cast<uint32_t>(width) == info.xsize && static_cast<uint32_t>(height) == info.ysize) {
+        return getFrame(framePosition, shown);
+    }
+    if (framePosition < 0) {
+        std::string str = "Frame position must be positive";
+        throw AnimatedDecoderError(str);
+    }
+
+    std::shared_ptr<ScaledOutput> output = getScaledOutput(width, height, sampler);
+    JxlFrameBuffer canvas = pool->acquire();
+    JxlFrame frame = { .pixels = output->pool->acquire(), .iccProfile = iccProfile, .duration = 0,
+                       .width = width, .height = height, .changed = {} };
+    {
+        std::unique_lock<std::mutex> indexGuard(indexLock, std::defer_lock);
+        if (!indexComplete.load(std::memory_order_acquire)) {
+            indexGuard.lock();
+        }
+        if (!ensureIndexed(framePosition + 1)) {
+            std::string str = "Requested frame index more than frames in the container";
+            throw AnimatedDecoderError(str);
+        }
+        // Half resolution cache entries hold all the detail of output this small
+        const bool halfSize = static_cast<uint32_t>(width) * 2 <= info.xsize
+                              && static_cast<uint32_t>(height) * 2 <= info.ysize;
+        frame.lossy = readFrame(framePosition, canvas.storage(), canDecodeReduced(framePosition, width, height), -1,
+                                halfSize) && !halfSize;
+        frame.duration = index.frames[framePosition].duration;
+    }
+    // Changed area grows by the filter footprint, one canvas pixel reaches this far into the output
+    const JxlCanvasRect changed = shown >= 0 && framePosition == shown + 1
+                                  ? getChangedRect(framePosition)
+                                  : JxlCanvasRect{ 0, 0, info.xsize, info.ysize };
+    if (!changed.empty()) {
+        const double scaleX = static_cast<double>(width) / info.xsize;
+        const double scaleY = static_cast<double>(height) / info.ysize;
+        const int64_t marginX = static_cast<int64_t>(std::ceil(3 * std::max(scaleX, 1.0)));
+        const int64_t marginY = static_cast<int64_t>(std::ceil(3 * std::max(scaleY, 1.0)));
+        frame.changed = {
+            static_cast<uint32_t>(std::max<int64_t>(static_cast<int64_t>(std::floor(changed.x0 * scaleX)) - marginX, 0)),
+            static_cast<uint32_t>(std::max<int64_t>(static_cast<int64_t>(std::floor(changed.y0 * scaleY)) - marginY, 0)),
+            static_cast<uint32_t>(std::min<int64_t>(static_cast<int64_t>(std::ceil(changed.x1 * scaleX)) + marginX, width)),
+            static_cast<uint32_t>(std::min<int64_t>(static_cast<int64_t>(std::ceil(changed.y1 * scaleY)) + marginY, height)),
+        };
+    }
+
+    if (pixelFormat == r8) {
+        output->scaler->scale(canvas.data(), frame.pixels.data());
+    } else if (pixelFormat == float16) {
+        scaleImageFloat16(reinterpret_cast<uint16_t*>(canvas.data()), static_cast<int>(info.xsize) * 4 * sizeof(uint16_t),
+                          info.xsize, info.ysize, reinterpret_cast<uint16_t*>(frame.pixels.data()),
+                          width * 4 * sizeof(uint16_t), width, height, 4, sampler);
+    } else {
+        scaleImageU16(reinterpret_cast<uint16_t*>(canvas.data()), static_cast<int>(info.xsize) * 4 * sizeof(uint16_t),
+                      info.xsize, info.ysize, reinterpret_cast<uint16_t*>(frame.pixels.data()),
+                      width * 4 * sizeof(uint16_t), width, height, 4, 16, sampler);
+    }
+    return frame;
+}
+
+std::shared_ptr<JxlAnimatedDecoder::ScaledOutput> JxlAnimatedDecoder::getScaledOutput(int width, int height,
+                                                                                      XSampler sampler) {
+    std::lock_guard guard(lock);
+    if (!scaledOutput || !scaledOutput->scaler->matches(info.xsize, info.ysize, width, height, sampler)) {
+        auto output = std::make_shared<ScaledOutput>();
+        output->scaler = std::make_unique<JxlFrameScaler>(info.xsize, info.ysize, width, height, sampler);
+        output->pool = std::make_unique<JxlFrameBufferPool>(static_cast<size_t>(width) * height * 4 * bytesPerSample);
+        scaledOutput = std::move(output);
+    }
+    return scaledOutput;
+}
+
+bool JxlAnimatedDecoder::canDecodeReduced(int framePosition, int width, int height) {
+    // DC is 1:8 of the canvas, skipping the rest of a frame later frames reference would break them
+    if (incremental.load(std::memory_order_acquire)
+        || static_cast<uint32_t>(width) * 8 > info.xsize || static_cast<uint32_t>(height) * 8 > info.ysize) {
+        return false;
+    }
+    const JxlFrameIndexEntry& frame = index.frames[framePosition];
+    return !index.layers[frame.firstLayer + frame.layersCount - 1].saved;
+}
+
+int JxlAnimatedDecoder::getFrame(int framePosition, std::vector<uint8_t>& pixels, int filled, bool* lossy) {
+    if (framePosition < 0) {
+        std::string str = "Frame position must be positive";
+        throw AnimatedDecoderError(str);
+    }
+
+    // Index can't grow under a frame being decoded, so decoding is serialized until it is complete
+    std::unique_lock<std::mutex> indexGuard(indexLock, std::defer_lock);
+    if (!indexComplete.load(std::memory_order_acquire)) {
+        indexGuard.lock();
+    }
+
+    if (!ensureIndexed(framePosition + 1)) {
+        std::string str = "Requested frame index more than frames in the container";
+        throw AnimatedDecoderError(str);
+    }
+
+    const bool upscaled = readFrame(framePosition, pixels, false, filled);
+    if (lossy) {
+        *lossy = upscaled;
+    }
+    return index.frames[framePosition].duration;
+}
+
+bool JxlAnimatedDecoder::readFrame(int framePosition, std::vector<uint8_t>& pixels, bool reduced, int filled,
+                                   bool acceptLossy) {
+    std::shared_ptr<JxlFrameCache> frameCache;
+    {
+        std::lock_guard guard(lock);
+        frameCache = cache;
+        acceptLossy = acceptLossy || lossyFrames;
+    }
+    bool lossy = false;
+    if (!frameCache || !frameCache->get(framePosition, pixels, acceptLossy, &lossy)) {
+        DecodingInstance* instance = acquireInstance(framePosition);
+        try {
+            reduced = decodeFrame(*instance, framePosition, pixels, reduced, filled);
+        } catch (AnimatedDecoderError& err) {
+            releaseInstance(instance);
+            throw;
+        }
+        releaseInstance(instance);
+        // Reduced frames are good only for the small size they were requested at
+        if (frameCache && !reduced) {
+            frameCache->put(framePosition, pixels);
+        }
+    }
+    nextPosition.store(framePosition + 1);
+    return lossy;
+}
+
+std::unique_ptr<JxlAnimatedDecoder::DecodingInstance> JxlAnimatedDecoder::makeInstance() {
+    auto instance = std::make_unique<DecodingInstance>();
+    instance->runner = JxlResizableParallelRunnerMake(nullptr);
+
+    instance->dec = JxlDecoderMake(nullptr);
+    if (!instance->dec) {
+        std::string str = "Cannot create decoder";
+        throw AnimatedDecoderError(str);
+    }
+
+    if (JXL_DEC_SUCCESS != JxlDecoderSetParallelRunner(instance->dec.get(),
+                                                       JxlResizableParallelRunner,
+                                                       instance->runner.get())) {
+        std::string str = "Cannot attach parallel runner to decoder";
+        throw AnimatedDecoderError(str);
+    }
+
+    JxlResizableParallelRunnerSetThreads(
+            instance->runner.get(),
+            JxlResizableParallelRunnerSuggestThreads(info.xsize, info.ysize));
+
+    const bool composing = incremental.load(std::memory_order_acquire);
+    if (composing) {
+        instance->compositor = std::make_unique<JxlFrameCompositor>(info.xsize, info.ysize);
+    }
+    if (JXL_DEC_SUCCESS != JxlDecoderSetCoalescing(instance->dec.get(), composing ? JXL_FALSE : JXL_TRUE)) {
+        std::string str = "Cannot coalesce frames";
+        throw AnimatedDecoderError(str);
+    }
+
+    rewind(*instance);
+    return instance;
+}
+
+JxlAnimatedDecoder::DecodingInstance* JxlAnimatedDecoder::acquireInstance(int framePosition) {
+    std::unique_lock<std::mutex> guard(instancesLock);
+    while (true) {
+        // Instance closest behind the target decodes the fewest frames to reach it
+        auto best = idleInstances.end();
+        for (auto it = idleInstances.begin(); it != idleInstances.end(); ++it) {
+            if (best == idleInstances.end()) {
+                best = it;
+                continue;
+            }
+            int position = (*it)->position;
+            int bestPosition = (*best)->position;
+            bool behind = position <= framePosition;
+            bool bestBehind = bestPosition <= framePosition;
+            if ((behind && (!bestBehind || position > bestPosition)) || (!behind && !bestBehind && position < bestPosition)) {
+                best = it;
+            }
+        }
+        if (best != idleInstances.end() && ((*best)->position <= framePosition || instances.size() >= maxInstances)) {
+            DecodingInstance* instance = *best;
+            idleInstances.erase(best);
+            return instance;
+        }
+        if (instances.size() < maxInstances) {
+            instances.push_back(makeInstance());
+            return instances.back().get();
+        }
+        instanceReleased.wait(guard);
+    }
+}
+
+void JxlAnimatedDecoder::releaseInstance(DecodingInstance* instance) {
+    {
+        std::lock_guard guard(instancesLock);
+        idleInstances.push_back(instance);
+    }
+    instanceReleased.notify_one();
+}
+
+void JxlAnimatedDecoder::setMaxInstances(size_t count) {
+    std::lock_guard guard(instancesLock);
+    maxInstances = std::max(count, static_cast<size_t>(1));
+}
+
+void JxlAnimatedDecoder::setFrameCache(size_t budget, JxlFrameCachePolicy policy, bool allowDownscale) {
+    std::lock_guard guard(lock);
+    if (budget == 0) {
+        cache.reset();
+        return;
+    }
+    // Cache packs and downscales 32-bit units, 16-bit samples are cached as two units per pixel without downscaling
+    cache = std::make_shared<JxlFrameCache>(info.xsize * bytesPerSample, info.ysize, budget, policy,
+                                            allowDownscale && bytesPerSample == 1);
+}
+
+void JxlAnimatedDecoder::setLossyFrames(bool accept) {
+    std::lock_guard guard(lock);
+    lossyFrames = accept;
+}
+
+void JxlAnimatedDecoder::setCheckpointBudget(size_t budget) {
+    std::lock_guard guard(checkpointsLock);
+    checkpointBudget = budget;
+    budgetSpacing = minCheckpointSpacing;
+    while (checkpointBytes > checkpointBudget) {
+        budgetSpacing = checkpointSpacing * 2;
+        respaceCheckpoints(budgetSpacing);
+    }
+}
+
+JxlFrame JxlAnimatedDecoder::nextFrame() {
+    return nextFrame(info.xsize, info.ysize);
+}
+
+JxlFrame JxlAnimatedDecoder::nextFrame(int width, int height, XSampler sampler) {
+    int next = nextPosition.load();
+    {
+        std::unique_lock<std::mutex> indexGuard(indexLock, std::defer_lock);
+        if (!indexComplete.load(std::memory_order_acquire)) {
+            indexGuard.lock();
+        }
+        if (!ensureIndexed(next + 1)) {
+            next = 0;
+        }
+    }
+    return getFrame(next, width, height, sampler);
+}
+
+JxlCompositingBenchmark JxlAnimatedDecoder::benchmarkCompositing(std::shared_ptr<JxlInputSource> source, int frames) {
+    JxlCompositingBenchmark benchmark = { 0, 0 };
+    JxlAnimationCompositing modes[2] = { compositeLibjxl, compositeIncremental };
+    double* results[2] = { &benchmark.libjxlMs, &benchmark.incrementalMs };
+    for (int i = 0; i < 2; ++i) {
+        JxlAnimatedDecoder decoder(source, modes[i]);
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            decoder.nextFrame();
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        *results[i] = elapsed.count();
+    }
+    return benchmark;
+}
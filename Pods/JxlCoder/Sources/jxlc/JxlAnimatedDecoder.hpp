@@ -36,6 +36,19 @@
 #include <jxl/resizable_parallel_runner.h>
 #include <jxl/resizable_parallel_runner_cxx.h>
 #include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include "JxlFrameIndex.hpp"
+#include "JxlFrameCompositor.hpp"
+#include "JxlFrameCache.hpp"
+#include "JxlFrameBuffer.hpp"
+#include "JxlInputSource.hpp"
+#include "JxlFrameScaler.hpp"
+#include "JxlToneMapper.hpp"
+#include "JxlDefinitions.h"
 
 class AnimatedDecoderError : public std::exception {
 public:
@@ -50,126 +63,131 @@ private:
 };
 
 struct JxlFrame {
-    std::vector<uint8_t> pixels;
-    std::vector<uint8_t> iccProfile;
+    // Pooled RGBA canvas in the output pixel format of the decoder, shared by copies of the frame
+    JxlFrameBuffer pixels;
+    // Same immutable profile for all frames of the animation
+    std::shared_ptr<const std::vector<uint8_t>> iccProfile;
     int duration;
+    // Size of the pixels, differs from the canvas for scaled frames
+    int width;
+    int height;
+    // Area that differs from the frame the caller passed as shown, in frame coordinates.
+    // Narrowed only when this frame directly follows that one in display order, otherwise
+    // the whole frame, e.g. after seeking, skipping or when no shown frame was passed.
+    // Region frames hold only the pixels of this area.
+    JxlCanvasRect changed;
+    // Upscaled from a half resolution cache entry, only when the decoder accepts lossy frames
+    bool lossy = false;
 };
 
-struct JxlFrameInfo {
-    int duration;
+struct JxlCompositingBenchmark {
+    double libjxlMs;
+    double incrementalMs;
 };
 
 class JxlAnimatedDecoder {
 public:
-    JxlAnimatedDecoder(std::vector<uint8_t>& src) {
-        this->data = src;
+    // Copies the bytes, prefer the shared input source for large animations
+    JxlAnimatedDecoder(std::vector<uint8_t>& src, JxlAnimationCompositing compositing = compositeLibjxl):
+        JxlAnimatedDecoder(JxlMakeInputSource(std::vector<uint8_t>(src)), compositing) {
+    }
 
-        if (JXL_SIG_INVALID == JxlSignatureCheck(src.data(), src.size())) {
-            std::string str = "Not an JXL image";
+    /**
+     * Pixel format is resolved the same way as for still images, optimal gives float16 for
+     * animations with more than 8 bits per sample. Tone mapping applies to 8-bit output of
+     * PQ, HLG and linear animations and is done on rows as libjxl produces them.
+     * Anything other than plain 8-bit output is composited by libjxl, and so is the rest of the
+     * animation from the first layer the own compositor can't reproduce, see JxlIndexedLayer::composable.
+     */
+    JxlAnimatedDecoder(std::shared_ptr<JxlInputSource> source, JxlAnimationCompositing compositing = compositeLibjxl,
+                       JxlDecodingPixelFormat pixelFormat = r8, bool toneMap = false) {
+        if (!source) {
+            std::string str = "Input is not available";
             throw AnimatedDecoderError(str);
         }
+        this->input = std::move(source);
 
-        runner = JxlResizableParallelRunnerMake(nullptr);
-
-        dec = JxlDecoderMake(nullptr);
-        if (!dec) {
-            std::string str = "Cannot create decoder";
-            throw AnimatedDecoderError(str);
-        }
-        if (JXL_DEC_SUCCESS !=
-            JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_BASIC_INFO |
-                                                 JXL_DEC_COLOR_ENCODING |
-                                                 JXL_DEC_FULL_IMAGE |
-                                                 JXL_DEC_FRAME)) {
-            std::string str = "Cannot subscribe to decoder events";
+        if (JXL_SIG_INVALID == JxlSignatureCheck(input->data(), input->size())) {
+            std::string str = "Not an JXL image";
             throw AnimatedDecoderError(str);
         }
 
-        if (JXL_DEC_SUCCESS != JxlDecoderSetParallelRunner(dec.get(),
-                                                           JxlResizableParallelRunner,
-                                                           runner.get())) {
-            std::string str = "Cannot attach parallel runner to decoder";
+        // Only the beginning is scanned, the rest of the frames table is built on demand
+        scanner = std::make_unique<JxlFrameIndexScanner>(input->data(), input->size(), &index);
+        if (!scanner->scan(compositing != compositeLibjxl ? probeFrames : 1)) {
+            std::string str = "Cannot build frames index";
             throw AnimatedDecoderError(str);
         }
+        indexComplete.store(scanner->isComplete());
 
-        if (JXL_DEC_SUCCESS != JxlDecoderSetCoalescing(dec.get(), JXL_FALSE)) {
-            std::string str = "Cannot coalesce frames";
-            throw AnimatedDecoderError(str);
+        info = index.info;
+        iccProfile = std::make_shared<const std::vector<uint8_t>>(index.iccProfile);
+        if (pixelFormat == optimal) {
+            pixelFormat = info.bits_per_sample > 8 ? float16 : r8;
+        }
+        this->pixelFormat = pixelFormat;
+        bytesPerSample = pixelFormat == r8 ? 1 : 2;
+        if (pixelFormat == r8 && toneMap && index.haveColorEncoding) {
+            toneMapper = std::make_unique<JxlToneMapper>(index.colorEncoding, info.intensity_target);
+            if (!toneMapper->isToneMapping()) {
+                toneMapper.reset();
+            } else {
+                // Profile describes the HDR encoding, mapped pixels are in sRGB transfer
+                iccProfile = std::make_shared<const std::vector<uint8_t>>();
+            }
         }
+        pool = std::make_unique<JxlFrameBufferPool>(static_cast<size_t>(info.xsize) * info.ysize * 4 * bytesPerSample);
+        loopCount = info.have_animation ? info.animation.num_loops : -1;
+        denom = info.have_animation ? info.animation.tps_denominator : 1;
+        numer = info.have_animation ? info.animation.tps_numerator : 1;
 
-        JxlDecoderSetInput(dec.get(), data.data(), data.size());
-        JxlDecoderCloseInput(dec.get());
-
-        for (;;) {
-            JxlDecoderStatus status = JxlDecoderProcessInput(dec.get());
-            if (status == JXL_DEC_ERROR) {
-                std::string str = "Cannot retreive basic info";
-                throw AnimatedDecoderError(str);
-            } else if (status == JXL_DEC_BASIC_INFO) {
-                if (JXL_DEC_SUCCESS != JxlDecoderGetBasicInfo(dec.get(), &info)) {
-                    std::string str = "Cannot retreive basic info";
-                    throw AnimatedDecoderError(str);
-                }
-                loopCount = info.have_animation ? info.animation.num_loops : -1;
-                denom = info.have_animation ? info.animation.tps_denominator : 1;
-                numer = info.have_animation ? info.animation.tps_numerator : 1;
-
-                JxlResizableParallelRunnerSetThreads(
-                        runner.get(),
-                        JxlResizableParallelRunnerSuggestThreads(info.xsize, info.ysize));
-            } else if (status == JXL_DEC_FULL_IMAGE) {
-                // All decoding successfully finished, we are at the end of the file.
-                // We must rewind the decoder to get a new frame.
-                JxlDecoderRewind(dec.get());
-                JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_FRAME | JXL_DEC_FULL_IMAGE);
-                JxlDecoderSetInput(dec.get(), data.data(), data.size());
-                JxlDecoderCloseInput(dec.get());
-                break;
-            } else if (status == JXL_DEC_FRAME) {
-                JxlFrameHeader header;
-                if (JXL_DEC_SUCCESS != JxlDecoderGetFrameHeader(dec.get(), &header)) {
-                    std::string str = "Cannot retreive frame header info";
-                    throw AnimatedDecoderError(str);
-                }
-                JxlAnimationHeader animation = info.animation;
-                int frameTime;
-                if (animation.tps_numerator)
-                    frameTime = (int)(1000.0 * header.duration * animation.tps_denominator / animation.tps_numerator);
-                else
-                    frameTime = 0;
-                JxlFrameInfo info = { .duration = frameTime };
-                this->frameInfo.push_back(info);
-            } else if (status == JXL_DEC_NEED_IMAGE_OUT_BUFFER) {
-                if (JXL_DEC_SUCCESS != JxlDecoderSkipCurrentFrame(dec.get())) {
-                    std::string str = "Cannot properly resolve animation info";
-                    throw AnimatedDecoderError(str);
-                }
-            } else if (status == JXL_DEC_COLOR_ENCODING) {
-                size_t iccSize;
-                if (JXL_DEC_SUCCESS !=
-                    JxlDecoderGetICCProfileSize(dec.get(), JXL_COLOR_PROFILE_TARGET_DATA,
-                                                &iccSize)) {
-                    std::string str = "Cannot retreive color info";
-                    throw AnimatedDecoderError(str);
+        if (compositing == compositeAuto) {
+            // Animations made only of full canvas frames gain nothing from own compositing,
+            // decided by the first frames to keep opening time independent of length
+            compositing = index.layers.size() != index.frames.size() ? compositeIncremental : compositeLibjxl;
+            for (const JxlIndexedLayer& layer : index.layers) {
+                if (layer.blendMode != JXL_BLEND_REPLACE || layer.haveCrop) {
+                    compositing = compositeIncremental;
+                    break;
                 }
-                iccProfile.resize(iccSize);
-                if (JXL_DEC_SUCCESS != JxlDecoderGetColorAsICCProfile(dec.get(), JXL_COLOR_PROFILE_TARGET_DATA,
-                                                                      iccProfile.data(), iccProfile.size())) {
-                    std::string str = "Cannot retreive color icc profile";
-                    throw AnimatedDecoderError(str);
-                }
-            } else if (status == JXL_DEC_SUCCESS) {
-                JxlDecoderRewind(dec.get());
-                JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_FRAME | JXL_DEC_FULL_IMAGE);
-                JxlDecoderSetInput(dec.get(), data.data(), data.size());
-                JxlDecoderCloseInput(dec.get());
-                break;
             }
         }
+        // Own compositor blends 8-bit pixels only
+        incremental = compositing == compositeIncremental && pixelFormat == r8 && !toneMapper
+                      && layersComposable(index.layers.size());
+
+        instances.push_back(makeInstance());
+        idleInstances.push_back(instances.back().get());
+    }
+
+    ~JxlAnimatedDecoder() {
+        stopIndexing.store(true);
+        if (indexWorker.joinable()) {
+            indexWorker.join();
+        }
     }
 
     JxlFrame nextFrame();
-    JxlFrame getFrame(int at);
+    /**
+     * Changed area is relative to the shown frame, -1 for none. Each consumer passes the frame
+     * it displays itself, so concurrent consumers never get an area computed against another one.
+     */
+    JxlFrame getFrame(int at, int shown = -1);
+    /**
+     * Decodes into caller's buffer reusing its storage, returns frame duration. When the buffer
+     * still holds the earlier frame filled, incremental compositing writes only the area changed since.
+     * A buffer that got a lossy frame is not a valid filled frame, the next one has to be written whole.
+     */
+    int getFrame(int at, std::vector<uint8_t>& pixels, int filled = -1, bool* lossy = nullptr);
+
+    /**
+     * Frames resampled to width x height. Filter weights are computed once for the size
+     * and reused by every frame, frames much smaller than the canvas are decoded
+     * from their reduced 1:8 progression when the animation allows it.
+     */
+    JxlFrame nextFrame(int width, int height, XSampler sampler = bilinear);
+    // Shown frame must have been requested at the same size and sampler
+    JxlFrame getFrame(int at, int width, int height, XSampler sampler = bilinear, int shown = -1);
 
     int getLoopCount() {
         return loopCount;
@@ -183,33 +201,200 @@ public:
         return info.ysize;
     }
 
-    int getNumberOfFrames() {
-        return static_cast<int>(frameInfo.size());
+    // Requires the whole frames table, blocks until it is scanned
+    int getNumberOfFrames();
+
+    int getFrameDuration(int frame);
+
+    bool isKeyframe(int frame);
+
+    // Requires the whole frames table, blocks until it is scanned
+    const JxlFrameIndex& getFrameIndex();
+
+    /**
+     * Area of the frame that differs from the previous frame in display order, derived from
+     * layer crops without decoding. Whole canvas for the first frame and for frames drawn
+     * over anything other than the previous frame.
+     */
+    JxlCanvasRect getChangedRect(int frame);
+
+    // Only the changed area of the frame relative to the shown frame, see JxlFrame::changed
+    JxlFrame getFrameRegion(int at, int shown);
+
+    // Duration of one loop in milliseconds, requires the whole frames table
+    double getTotalDuration();
+
+    /**
+     * Frame displayed at time in milliseconds from the start of playback, binary search over
+     * frame start times. Time past the end wraps while loops remain, then stays on the last frame.
+     * Only as much of the frames table as the time reaches is scanned within the first loop.
+     */
+    int getFrameAt(double time);
+
+    // Frame displayed at time, decoded from the nearest frame it can be reconstructed from
+    JxlFrame seek(double time);
+
+    // Empty when frames are tone mapped, see getPrimaries
+    std::shared_ptr<const std::vector<uint8_t>> getIccProfile() {
+        return iccProfile;
+    }
+
+    // Resolved output format, r8 for tone mapped frames
+    JxlDecodingPixelFormat getPixelFormat() {
+        return pixelFormat;
     }
 
-    int getFrameDuration(int frame) {
+    bool isToneMapping() {
+        return toneMapper != nullptr;
+    }
+
+    // Primaries tone mapped frames are encoded in with the sRGB transfer
+    JxlPrimaries getPrimaries() {
+        return index.haveColorEncoding ? index.colorEncoding.primaries : JXL_PRIMARIES_SRGB;
+    }
+
+    // Scans the rest of the frames table on a background thread
+    void indexInBackground();
+
+    /**
+     * Allows up to count decoder instances sharing the input, index and cache, so getFrame
+     * calls from different threads decode concurrently. Instances are created on demand.
+     */
+    void setMaxInstances(size_t count);
+
+    /**
+     * Keeps decoded frames within budget bytes so looping animations decode every frame once,
+     * zero budget disables the cache
+     */
+    void setFrameCache(size_t budget, JxlFrameCachePolicy policy = cacheWholeLoop, bool allowDownscale = false);
+
+    /**
+     * Lets full size frames come upscaled from half resolution cache entries instead of being
+     * decoded again, such frames are marked lossy. Otherwise those entries serve only frames
+     * scaled to half the canvas or less.
+     */
+    void setLossyFrames(bool accept);
+
+    std::shared_ptr<JxlFrameCache> getFrameCache() {
         std::lock_guard guard(lock);
-        if (frame < 0) {
-            return 0;
-        }
+        return cache;
+    }
 
-        if (frame >= this->frameInfo.size()) {
-            return 0;
-        }
-        JxlFrameInfo info = this->frameInfo[frame];
-        return info.duration;
+    // Turns false once a layer requires libjxl compositing
+    bool isIncrementalCompositing() {
+        return incremental.load(std::memory_order_acquire);
     }
 
+    /**
+     * Bytes kept in compositor checkpoints, which let incremental compositing seek without
+     * replaying from the last independent frame. Spacing doubles when the budget is exceeded.
+     */
+    void setCheckpointBudget(size_t budget);
+
+    /**
+     * Plays first frames sequentially with libjxl coalescing and with incremental compositing
+     */
+    static JxlCompositingBenchmark benchmarkCompositing(std::shared_ptr<JxlInputSource> source, int frames);
+
 private:
-    std::vector<uint8_t> data;
-    std::vector<uint8_t> iccProfile;
-    std::vector<JxlFrameInfo> frameInfo;
-    JxlDecoderPtr dec;
+    struct ToneMappingTarget {
+        const JxlToneMapper* mapper;
+        uint8_t* pixels;
+        size_t stride;
+    };
+
+    static void toneMapRows(void* opaque, size_t x, size_t y, size_t count, const void* pixels);
+
+    // libjxl decoder with the position and canvas it has reached
+    struct DecodingInstance {
+        JxlDecoderPtr dec;
+        JxlResizableParallelRunnerPtr runner;
+        // Index of the frame the decoder will produce next without rewinding
+        int position = 0;
+        size_t layerPosition = 0;
+        // Own compositing of layers decoded without coalescing
+        std::unique_ptr<JxlFrameCompositor> compositor;
+        std::vector<uint8_t> layerPixels;
+        // Destination of the tone mapping callback for the frame being decoded
+        ToneMappingTarget toneMapping;
+    };
+
+    // Scaler of the last requested output size with the pool of its frames
+    struct ScaledOutput {
+        std::unique_ptr<JxlFrameScaler> scaler;
+        std::unique_ptr<JxlFrameBufferPool> pool;
+    };
+
+    std::unique_ptr<DecodingInstance> makeInstance();
+    DecodingInstance* acquireInstance(int framePosition);
+    void releaseInstance(DecodingInstance* instance);
+
+    bool ensureIndexed(size_t frames);
+    void rewind(DecodingInstance& instance);
+    bool readFrame(int framePosition, std::vector<uint8_t>& pixels, bool reduced = false, int filled = -1,
+                   bool acceptLossy = false);
+    bool decodeFrame(DecodingInstance& instance, int framePosition, std::vector<uint8_t>& pixels, bool reduced,
+                     int filled);
+    std::shared_ptr<ScaledOutput> getScaledOutput(int width, int height, XSampler sampler);
+    bool canDecodeReduced(int framePosition, int width, int height);
+    JxlCanvasRect changedRect(int framePosition);
+    void composeFrame(DecodingInstance& instance, int framePosition, std::vector<uint8_t>& pixels, int filled);
+    void seekLayer(DecodingInstance& instance, size_t layer);
+    void decodeLayer(DecodingInstance& instance, const JxlIndexedLayer& layer);
+    void saveCheckpoint(const JxlFrameCompositor& compositor, int position);
+    bool layersComposable(size_t end);
+    void respaceCheckpoints(int spacing);
+
+    static const int maxCheckpoints = 8;
+    // Spacing is a power of two multiple of this, so doubling it keeps the remaining checkpoints evenly spread
+    static const int minCheckpointSpacing = 8;
+    static const int probeFrames = 8;
+    // Frames scanned per step when the table is extended ahead of use
+    static const int indexStep = 64;
+
+    // Shared, never copied
+    std::shared_ptr<JxlInputSource> input;
+    JxlFrameIndex index;
+    std::unique_ptr<JxlFrameIndexScanner> scanner;
+    // Guards the index while it grows, once complete it is read without locking
+    std::mutex indexLock;
+    std::atomic<bool> indexComplete = false;
+    std::thread indexWorker;
+    std::atomic<bool> stopIndexing = false;
+    std::shared_ptr<const std::vector<uint8_t>> iccProfile;
+    std::unique_ptr<JxlFrameBufferPool> pool;
     JxlBasicInfo info;
     int loopCount;
     int denom;
     int numer;
-    JxlResizableParallelRunnerPtr runner;
+    std::atomic<bool> incremental = false;
+    // Leading layers already checked to be composable
+    std::atomic<size_t> composableLayers = 0;
+    JxlDecodingPixelFormat pixelFormat = r8;
+    size_t bytesPerSample = 1;
+    std::unique_ptr<JxlToneMapper> toneMapper;
+
+    std::vector<std::unique_ptr<DecodingInstance>> instances;
+    std::vector<DecodingInstance*> idleInstances;
+    size_t maxInstances = 1;
+    std::mutex instancesLock;
+    std::condition_variable instanceReleased;
+
+    // Frame returned by nextFrame, frames served from cache don't move any decoder
+    std::atomic<int> nextPosition = 0;
+    std::shared_ptr<JxlFrameCache> cache;
+    bool lossyFrames = false;
+    std::shared_ptr<ScaledOutput> scaledOutput;
+    // Compositor state after evenly spaced frames, shared by all instances
+    std::map<int, JxlFrameCompositor::Checkpoint> checkpoints;
+    std::mutex checkpointsLock;
+    size_t checkpointBudget = 64 * 1024 * 1024;
+    size_t checkpointBytes = 0;
+    // Frames between checkpoints, grows with the frames count and when the budget is exceeded
+    int checkpointSpacing = minCheckpointSpacing;
+    // Lower bound of the spacing set by the budget
+    int budgetSpacing = minCheckpointSpacing;
+    // Guards cache and scaled output replacement
     std::mutex lock;
 };
 
@@ -24,9 +24,21 @@
 //
 
 #include "JxlAnimatedEncoder.hpp"
+#include <algorithm>
+#include <chrono>
 
 void JxlAnimatedEncoder::addFrame(std::vector<uint8_t>& data, int frameTime) {
+    // Frames already in the queue go first to keep the order of submission
+    flush();
+    addFrameData(data.data(), data.size(), frameTime);
+}
+
+void JxlAnimatedEncoder::addFrameData(const uint8_t* data, size_t size, int frameTime) {
     std::lock_guard guard(lock);
+    if (outputFailed) {
+        std::string str = "Output has failed, the image cannot be continued";
+        throw AnimatedEncoderError(str);
+    }
 
     addedFrames += 1;
 
@@ -46,41 +58,280 @@ void JxlAnimatedEncoder::addFrame(std::vector<uint8_t>& data, int frameTime) {
 
     if (JXL_ENC_SUCCESS !=
         JxlEncoderAddImageFrame(frameSettings, &pixelFormat,
-                                (void *) data.data(),
-                                sizeof(uint8_t) * data.size())) {
+                                (void *) data,
+                                sizeof(uint8_t) * size)) {
         std::string str = "Encoding frame has failed";
         throw AnimatedEncoderError(str);
     }
+
+    // libjxl only queues the frame, encoding happens while output is drained
+    drainOutput(false);
 }
 
-void JxlAnimatedEncoder::encode(std::vector<uint8_t>& dst) {
+void JxlAnimatedEncoder::drainOutput(bool closing) {
+    if (outputChunk.empty()) {
+        outputChunk.resize(64 * 1024);
+    }
+    JxlEncoderStatus processResult = JXL_ENC_NEED_MORE_OUTPUT;
+    while (processResult == JXL_ENC_NEED_MORE_OUTPUT) {
+        uint8_t *nextOut = outputChunk.data();
+        size_t availOut = outputChunk.size();
+        processResult = JxlEncoderProcessOutput(enc.get(), &nextOut, &availOut);
+        size_t produced = nextOut - outputChunk.data();
+        if (produced > 0 && !sink) {
+            encoded.insert(encoded.end(), outputChunk.data(), outputChunk.data() + produced);
+            bytesWritten += produced;
+        } else if (produced > 0) {
+            if (!sink->write(outputChunk.data(), produced)) {
+                // Part of the stream is lost, anything written after it would be corrupted
+                outputFailed = true;
+                sink->abort();
+                std::string str = "Cannot write to output sink";
+                throw AnimatedEncoderError(str);
+            }
+            bytesWritten += produced;
+        }
+        // Until frames are closed libjxl asks for more output even with nothing left to write,
+        // a partially filled chunk means everything encoded so far is out
+        if (!closing && availOut > 0) {
+            break;
+        }
+    }
+    if (processResult != JXL_ENC_SUCCESS && processResult != JXL_ENC_NEED_MORE_OUTPUT) {
+        outputFailed = true;
+        if (sink) {
+            sink->abort();
+        }
+        std::string str = "Encoding image has failed";
+        throw AnimatedEncoderError(str);
+    }
+}
+
+size_t JxlAnimatedEncoder::getFrameSize() {
+    size_t bytesPerSample = pixelFormat.data_type == JXL_TYPE_FLOAT16 ? 2 : 1;
+    return static_cast<size_t>(width) * static_cast<size_t>(height) * pixelFormat.num_channels * bytesPerSample;
+}
+
+void JxlAnimatedEncoder::throwIfFailed() {
+    if (!workerError.empty()) {
+        throw AnimatedEncoderError(workerError);
+    }
+}
+
+void JxlAnimatedEncoder::enqueueFrame(std::vector<uint8_t>&& data, int frameTime) {
+    if (data.size() < getFrameSize()) {
+        std::string str = "Frame size doesn't match encoder dimensions";
+        throw AnimatedEncoderError(str);
+    }
+    PendingFrame frame;
+    frame.data = std::move(data);
+    frame.duration = frameTime;
+    pushFrame(std::move(frame));
+}
+
+void JxlAnimatedEncoder::enqueueFrame(JxlFrameBuffer buffer, int frameTime) {
+    if (buffer.size() < getFrameSize()) {
+        std::string str = "Frame size doesn't match encoder dimensions";
+        throw AnimatedEncoderError(str);
+    }
+    PendingFrame frame;
+    frame.buffer = std::move(buffer);
+    frame.duration = frameTime;
+    pushFrame(std::move(frame));
+}
+
+JxlFrameBuffer JxlAnimatedEncoder::acquireFrameBuffer() {
+    {
+        std::lock_guard guard(queueLock);
+        if (!bufferPool) {
+            // Queue slots, the frame on the worker and the one the producer is filling
+            bufferPool = std::make_unique<JxlFrameBufferPool>(getFrameSize(), queueDepth + 2);
+        }
+    }
+    return bufferPool->acquire();
+}
+
+void JxlAnimatedEncoder::pushFrame(PendingFrame&& frame) {
+    std::unique_lock queueGuard(queueLock);
+    throwIfFailed();
+    if (stopping) {
+        std::string str = "Cannot add frames after animation was encoded";
+        throw AnimatedEncoderError(str);
+    }
+    if (!worker.joinable()) {
+        worker = std::thread(&JxlAnimatedEncoder::workerLoop, this);
+    }
+
+    if (pending.size() >= queueDepth) {
+        queueStats.stalls += 1;
+        auto stallStart = std::chrono::steady_clock::now();
+        queueNotFull.wait(queueGuard, [this] {
+            return pending.size() < queueDepth || !workerError.empty();
+        });
+        std::chrono::duration<double, std::milli> stalled = std::chrono::steady_clock::now() - stallStart;
+        queueStats.stalledMs += stalled.count();
+        throwIfFailed();
+    }
+
+    pending.push_back(std::move(frame));
+    queueStats.queuedFrames += 1;
+    queueStats.peakDepth = std::max(queueStats.peakDepth, pending.size() + (encodingFrame ? 1 : 0));
+    queueGuard.unlock();
+    queueNotEmpty.notify_one();
+}
+
+void JxlAnimatedEncoder::workerLoop() {
+    while (true) {
+        PendingFrame frame;
+        {
+            std::unique_lock queueGuard(queueLock);
+            queueNotEmpty.wait(queueGuard, [this] {
+                return stopping || !pending.empty();
+            });
+            if (pending.empty()) {
+                return;
+            }
+            frame = std::move(pending.front());
+            pending.pop_front();
+            encodingFrame = true;
+        }
+        queueNotFull.notify_one();
+
+        std::string error;
+        try {
+            if (frame.buffer.size() > 0) {
+                addFrameData(frame.buffer.data(), frame.buffer.size(), frame.duration);
+            } else {
+                addFrameData(frame.data.data(), frame.data.size(), frame.duration);
+            }
+        } catch (AnimatedEncoderError& err) {
+            error = err.what();
+        } catch (std::bad_alloc& err) {
+            error = "Not enough memory to encode frame";
+        }
+        // Hand the buffer back to the pool before the producer is woken up
+        frame = PendingFrame();
+
+        {
+            std::lock_guard queueGuard(queueLock);
+            encodingFrame = false;
+            if (error.empty()) {
+                queueStats.encodedFrames += 1;
+            } else if (workerError.empty()) {
+                workerError = error;
+                // Nothing after a failed frame can be encoded, drop the rest
+                pending.clear();
+            }
+        }
+        queueNotFull.notify_all();
+        queueDrained.notify_all();
+    }
+}
+
+void JxlAnimatedEncoder::flush() {
+    std::unique_lock queueGuard(queueLock);
+    queueDrained.wait(queueGuard, [this] {
+        return pending.empty() && !encodingFrame;
+    });
+    throwIfFailed();
+}
+
+void JxlAnimatedEncoder::stopWorker() {
+    {
+        std::lock_guard queueGuard(queueLock);
+        stopping = true;
+    }
+    queueNotEmpty.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void JxlAnimatedEncoder::setQueueDepth(size_t depth) {
+    {
+        std::lock_guard queueGuard(queueLock);
+        queueDepth = std::max(depth, static_cast<size_t>(1));
+    }
+    queueNotFull.notify_all();
+}
+
+JxlEncoderQueueStats JxlAnimatedEncoder::getQueueStats() {
+    std::lock_guard queueGuard(queueLock);
+    JxlEncoderQueueStats stats = queueStats;
+    stats.depth = pending.size() + (encodingFrame ? 1 : 0);
+    stats.capacity = queueDepth;
+    return stats;
+}
+
+void JxlAnimatedEncoder::setOutputSink(std::shared_ptr<JxlOutputSink> outputSink) {
+    {
+        std::lock_guard queueGuard(queueLock);
+        if (!pending.empty() || encodingFrame) {
+            std::string str = "Output sink must be set before adding frames";
+            throw AnimatedEncoderError(str);
+        }
+    }
+    std::lock_guard guard(lock);
+    if (addedFrames > 0) {
+        std::string str = "Output sink must be set before adding frames";
+        throw AnimatedEncoderError(str);
+    }
+    sink = outputSink;
+}
+
+void JxlAnimatedEncoder::finish() {
+    flush();
+    stopWorker();
     std::lock_guard guard(lock);
+    if (!sink) {
+        std::string str = "Output sink is not set, use encode to get the image";
+        throw AnimatedEncoderError(str);
+    }
     if (addedFrames == 0) {
         std::string str = "Cannot compress empty animation";
         throw AnimatedEncoderError(str);
     }
+    if (outputFailed) {
+        std::string str = "Output has failed, the image cannot be continued";
+        throw AnimatedEncoderError(str);
+    }
     JxlEncoderCloseFrames(enc.get());
+    drainOutput(true);
+    if (!sink->finish()) {
+        outputFailed = true;
+        sink->abort();
+        std::string str = "Cannot write to output sink";
+        throw AnimatedEncoderError(str);
+    }
+}
 
-    dst.resize(64);
-    uint8_t *nextOut = dst.data();
-    size_t availOut = dst.size() - (nextOut - dst.data());
-    JxlEncoderStatus processResult = JXL_ENC_NEED_MORE_OUTPUT;
-    while (processResult == JXL_ENC_NEED_MORE_OUTPUT) {
-        processResult = JxlEncoderProcessOutput(enc.get(), &nextOut, &availOut);
-        if (processResult == JXL_ENC_NEED_MORE_OUTPUT) {
-            size_t offset = nextOut - dst.data();
-            dst.resize(dst.size() * 2);
-            nextOut = dst.data() + offset;
-            availOut = dst.size() - offset;
-        }
+void JxlAnimatedEncoder::encode(std::vector<uint8_t>& dst) {
+    flush();
+    stopWorker();
+    std::lock_guard guard(lock);
+    if (sink) {
+        std::string str = "Image is streamed to the output sink, use finish instead";
+        throw AnimatedEncoderError(str);
     }
-    dst.resize(nextOut - dst.data());
-    if (JXL_ENC_SUCCESS != processResult) {
-        std::string str = "Encoding image has failed";
+    if (addedFrames == 0) {
+        std::string str = "Cannot compress empty animation";
         throw AnimatedEncoderError(str);
     }
+    if (outputFailed) {
+        std::string str = "Output has failed, the image cannot be continued";
+        throw AnimatedEncoderError(str);
+    }
+    // Frames are already encoded, only the tail is left
+    JxlEncoderCloseFrames(enc.get());
+    drainOutput(true);
+    dst.swap(encoded);
+    encoded = std::vector<uint8_t>();
 }
 
 JxlAnimatedEncoder::~JxlAnimatedEncoder() {
-
+    {
+        std::lock_guard queueGuard(queueLock);
+        pending.clear();
+    }
+    stopWorker();
 }
@@ -34,8 +34,14 @@
 #include <jxl/thread_parallel_runner_cxx.h>
 #include <string>
 #include "JxlDefinitions.h"
+#include "JxlWorker.hpp"
+#include "JxlFrameBuffer.hpp"
+#include "JxlOutputSink.hpp"
 #include <vector>
 #include <thread>
+#include <deque>
+#include <memory>
+#include <condition_variable>
 
 class AnimatedEncoderError : public std::exception {
 public:
@@ -49,12 +55,26 @@ private:
     std::string errorMessage;
 };
 
+struct JxlEncoderQueueStats {
+    // Frames waiting in the queue plus the one being encoded
+    size_t depth;
+    size_t peakDepth;
+    size_t capacity;
+    uint64_t queuedFrames;
+    uint64_t encodedFrames;
+    // How many times a producer had to wait for a free slot and for how long in total
+    uint64_t stalls;
+    double stalledMs;
+};
+
 class JxlAnimatedEncoder {
 public:
     JxlAnimatedEncoder(int width, int height, JxlPixelType pixelType, 
                        JxlEncodingPixelFormat encodingPixelFormat, 
                        JxlCompressionOption compressionOption, 
-                       int numLoops, int quality, int effort): width(width), height(height),
+                       int numLoops, int quality, int effort,
+                       JxlEncodingColorSpace colorProfile = srgb,
+                       const std::vector<uint8_t>& iccProfile = std::vector<uint8_t>()): width(width), height(height),
     pixelType(pixelType), encodingPixelFormat(encodingPixelFormat),
     compressionOption(compressionOption), quality(quality), effort(effort) {
         if (!enc || !runner) {
@@ -129,10 +149,7 @@ public:
                 break;
         }
 
-        JxlColorEncoding colorEncoding = {};
-        JxlColorEncodingSetToSRGB(&colorEncoding, pixelFormat.num_channels < 3);
-        if (JXL_ENC_SUCCESS !=
-            JxlEncoderSetColorEncoding(enc.get(), &colorEncoding)) {
+        if (!JxlSetEncoderColorProfile(enc.get(), colorProfile, iccProfile, pixelFormat.num_channels < 3)) {
             std::string str = "Cannot set color encoding";
             throw AnimatedEncoderError(str);
         }
@@ -184,8 +201,45 @@ public:
     }
 
     void addFrame(std::vector<uint8_t>& data, int frameTime);
+
+    /**
+     * Queues a frame for encoding on a background worker and returns immediately
+     * while there is a free slot, otherwise waits for one. Frames are encoded in order
+     * of submission, an error on the worker is rethrown by the next call.
+     */
+    void enqueueFrame(std::vector<uint8_t>&& data, int frameTime);
+    void enqueueFrame(JxlFrameBuffer buffer, int frameTime);
+
+    // Frame sized buffer from the encoder's pool, returns to it once the frame is encoded
+    JxlFrameBuffer acquireFrameBuffer();
+
+    // Waits until every queued frame is encoded
+    void flush();
+
+    void setQueueDepth(size_t depth);
+    JxlEncoderQueueStats getQueueStats();
+
     void encode(std::vector<uint8_t>& dst);
 
+    /**
+     * Streams the image into the sink as frames are added instead of keeping it in memory
+     * until encode(). Has to be set before the first frame, the image is then completed by finish().
+     * When the output fails the sink is aborted and the image can't be continued.
+     */
+    void setOutputSink(std::shared_ptr<JxlOutputSink> outputSink);
+    void finish();
+
+    bool isStreaming() {
+        std::lock_guard guard(lock);
+        return sink != nullptr;
+    }
+
+    // Compressed bytes produced so far, to the sink or to the buffer returned by encode()
+    uint64_t getBytesWritten() {
+        std::lock_guard guard(lock);
+        return bytesWritten;
+    }
+
     int getWidth() {
         return width;
     }
@@ -204,6 +258,20 @@ public:
 
     ~JxlAnimatedEncoder();
 private:
+    struct PendingFrame {
+        std::vector<uint8_t> data;
+        JxlFrameBuffer buffer;
+        int duration = 0;
+    };
+
+    void addFrameData(const uint8_t* data, size_t size, int frameTime);
+    void pushFrame(PendingFrame&& frame);
+    void workerLoop();
+    void stopWorker();
+    void throwIfFailed();
+    void drainOutput(bool closing);
+    size_t getFrameSize();
+
     const int width;
     const int height;
     const int quality;
@@ -234,7 +302,27 @@ private:
         return distance;
     }
 
+    std::shared_ptr<JxlOutputSink> sink;
+    std::vector<uint8_t> outputChunk;
+    // Output encoded so far when there is no sink
+    std::vector<uint8_t> encoded;
+    uint64_t bytesWritten = 0;
+    bool outputFailed = false;
+
     std::mutex lock;
+
+    std::mutex queueLock;
+    std::condition_variable queueNotEmpty;
+    std::condition_variable queueNotFull;
+    std::condition_variable queueDrained;
+    std::deque<PendingFrame> pending;
+    std::thread worker;
+    std::unique_ptr<JxlFrameBufferPool> bufferPool;
+    size_t queueDepth = 3;
+    bool encodingFrame = false;
+    bool stopping = false;
+    std::string workerError;
+    JxlEncoderQueueStats queueStats = {};
 };
 
 #endif
@@ -0,0 +1,149 @@
+//
+//  JxlAnimationPlayer.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlAnimationPlayer.hpp"
+#include <chrono>
+
+void JxlAnimationPlayer::start() {
+    if (worker.joinable()) {
+        return;
+    }
+    head.store(0);
+    tail.store(0);
+    for (JxlPlaybackFrame& slot : slots) {
+        slot.index = -1;
+        slot.lossy = false;
+    }
+    hasCurrent = false;
+    shownFrame = SIZE_MAX;
+    lateFrame = SIZE_MAX;
+    droppedFrames.store(0);
+    underruns.store(0);
+    failed.store(false);
+    producerDone.store(false);
+    stopping.store(false);
+    worker = std::thread(&JxlAnimationPlayer::run, this);
+}
+
+void JxlAnimationPlayer::stop() {
+    stopping.store(true);
+    spaceAvailable.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void JxlAnimationPlayer::run() {
+    const int framesCount = decoder.getNumberOfFrames();
+    // 0 is infinite, still images report -1 and play once
+    const int loops = decoder.getLoopCount();
+    double presentationTime = 0;
+    int loop = 0;
+    int index = 0;
+    try {
+        while (!stopping.load()) {
+            const size_t position = tail.load(std::memory_order_relaxed);
+            {
+                std::unique_lock<std::mutex> guard(spaceLock);
+                // Consumer doesn't take the lock to notify, timeout covers a missed wake up
+                spaceAvailable.wait_for(guard, std::chrono::milliseconds(10), [&] {
+                    return stopping.load() || position - head.load(std::memory_order_acquire) < capacity;
+                });
+            }
+            if (stopping.load()) {
+                break;
+            }
+            if (position - head.load(std::memory_order_acquire) >= capacity) {
+                continue;
+            }
+
+            JxlPlaybackFrame& slot = slots[position % capacity];
+            // Slot still holds the frame decoded capacity frames ago, only the difference is written
+            slot.duration = decoder.getFrame(index, slot.pixels, slot.lossy ? -1 : slot.index, &slot.lossy);
+            slot.changed = decoder.getChangedRect(index);
+            slot.index = index;
+            slot.presentationTime = presentationTime;
+            presentationTime += slot.duration;
+            tail.store(position + 1, std::memory_order_release);
+
+            if (++index == framesCount) {
+                index = 0;
+                loop += 1;
+                if (loops != 0 && loop >= std::max(loops, 1)) {
+                    break;
+                }
+            }
+        }
+    } catch (std::exception& err) {
+        errorMessage = err.what();
+        failed.store(true, std::memory_order_release);
+    }
+    producerDone.store(true, std::memory_order_release);
+}
+
+const JxlPlaybackFrame* JxlAnimationPlayer::frameAt(double time, JxlCanvasRect* changed) {
+    size_t position = head.load(std::memory_order_relaxed);
+    const size_t ready = tail.load(std::memory_order_acquire);
+    if (!hasCurrent) {
+        if (position == ready) {
+            return nullptr;
+        }
+        hasCurrent = true;
+    }
+    const size_t previous = shownFrame;
+
+    for (;;) {
+        const JxlPlaybackFrame& current = slots[position % capacity];
+        if (time < current.presentationTime + current.duration) {
+            break;
+        }
+        if (position + 1 == ready) {
+            // Next frame is late, keep the current one on screen
+            if (lateFrame != position && !producerDone.load(std::memory_order_acquire)) {
+                lateFrame = position;
+                underruns.fetch_add(1, std::memory_order_relaxed);
+            }
+            break;
+        }
+        if (shownFrame != position) {
+            droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+        position += 1;
+        head.store(position, std::memory_order_release);
+        spaceAvailable.notify_one();
+    }
+
+    shownFrame = position;
+    if (changed) {
+        if (position == previous) {
+            *changed = {};
+        } else if (previous != SIZE_MAX && position == previous + 1) {
+            *changed = slots[position % capacity].changed;
+        } else {
+            *changed = { 0, 0, static_cast<uint32_t>(decoder.getWidth()), static_cast<uint32_t>(decoder.getHeight()) };
+        }
+    }
+    return &slots[position % capacity];
+}
@@ -0,0 +1,133 @@
+//
+//  JxlAnimationPlayer.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlAnimationPlayer_hpp
+#define JxlAnimationPlayer_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include "JxlAnimatedDecoder.hpp"
+
+struct JxlPlaybackFrame {
+    std::vector<uint8_t> pixels;
+    // -1 while the slot was not filled yet
+    int index;
+    int duration;
+    // Milliseconds since playback start when the frame has to be shown
+    double presentationTime;
+    // Area that differs from the frame decoded before it
+    JxlCanvasRect changed;
+    // Upscaled from the frame cache, the next frame in the slot is written whole
+    bool lossy;
+};
+
+/**
+ * Decodes frames ahead on a worker thread into a bounded ring of reusable buffers.
+ * The ring is single producer single consumer: the worker only advances the tail,
+ * the consumer only advances the head, so presenting a frame never takes a lock.
+ * Decoder must outlive the player and shouldn't be used elsewhere while playing.
+ */
+class JxlAnimationPlayer {
+public:
+    JxlAnimationPlayer(JxlAnimatedDecoder& decoder, size_t depth = 3):
+        decoder(decoder), capacity(std::max<size_t>(depth, 2)), slots(std::max<size_t>(depth, 2)) {
+    }
+
+    ~JxlAnimationPlayer() {
+        stop();
+    }
+
+    void start();
+    void stop();
+
+    /**
+     * Consumer side, lock free. Returns the frame to show at time in milliseconds since start.
+     * Returned frame stays valid until the next call. Frames which are already out of their time
+     * while a newer one is ready are dropped, if the next frame is late the current one is kept and
+     * underrun is counted. Returns nullptr only before the first frame is ready.
+     * Changed is the area that differs from the frame the previous call returned: empty when it is
+     * the same frame, the whole canvas for the first one or when frames were dropped in between.
+     */
+    const JxlPlaybackFrame* frameAt(double time, JxlCanvasRect* changed = nullptr);
+
+    // All loops were decoded and the last frame is on screen
+    bool isFinished() {
+        return producerDone.load(std::memory_order_acquire) && head.load() + 1 >= tail.load();
+    }
+
+    uint64_t getDroppedFrames() {
+        return droppedFrames.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getUnderruns() {
+        return underruns.load(std::memory_order_relaxed);
+    }
+
+    // Worker stops on decoding error, message is available once it happened
+    bool hasFailed() {
+        return failed.load(std::memory_order_acquire);
+    }
+
+    std::string getErrorMessage() {
+        return hasFailed() ? errorMessage : std::string();
+    }
+
+private:
+    void run();
+
+    JxlAnimatedDecoder& decoder;
+    const size_t capacity;
+    std::vector<JxlPlaybackFrame> slots;
+    // Monotonic counters, slot is counter % capacity
+    std::atomic<size_t> head = 0;
+    std::atomic<size_t> tail = 0;
+    // Consumer owns the slot at head while it is shown
+    bool hasCurrent = false;
+    size_t shownFrame = SIZE_MAX;
+    size_t lateFrame = SIZE_MAX;
+
+    std::thread worker;
+    std::atomic<bool> stopping = false;
+    std::atomic<bool> producerDone = false;
+    std::mutex spaceLock;
+    std::condition_variable spaceAvailable;
+
+    std::atomic<uint64_t> droppedFrames = 0;
+    std::atomic<uint64_t> underruns = 0;
+    std::atomic<bool> failed = false;
+    std::string errorMessage;
+};
+
+#endif
+
+#endif /* JxlAnimationPlayer_hpp */
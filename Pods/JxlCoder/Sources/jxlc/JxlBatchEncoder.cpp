@@ -0,0 +1,145 @@
+//
+//  JxlBatchEncoder.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlBatchEncoder.hpp"
+#include "JxlEncoderSession.hpp"
+#include "JxlResourceEstimator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+static const size_t kJxlGroupDim = 256;
+
+static size_t JxlUsefulThreads(const JxlBatchEncodingItem& item) {
+    size_t groups = ((item.xsize + kJxlGroupDim - 1) / kJxlGroupDim) * ((item.ysize + kJxlGroupDim - 1) / kJxlGroupDim);
+    // Butteraugli iterations and tree learning on high efforts are mostly serial
+    if (item.params.effort >= 8) {
+        groups = (groups + 1) / 2;
+    }
+    return std::max(groups, static_cast<size_t>(1));
+}
+
+static double JxlEncodingCost(const JxlBatchEncodingItem& item) {
+    JxlResourceQuery query;
+    query.width = item.xsize;
+    query.height = item.ysize;
+    query.channels = item.params.colorspace == rgba ? 4 : 3;
+    query.effort = item.params.effort;
+    query.compressionOption = item.params.compressionOption;
+    return JxlResourceEstimator::shared().estimate(query).relativeCost;
+}
+
+JxlBatchSchedule PlanJxlBatch(const std::vector<JxlBatchEncodingItem>& items, size_t coreBudget) {
+    if (coreBudget == 0) {
+        coreBudget = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    JxlBatchSchedule schedule;
+    std::vector<size_t> threads;
+    for (size_t i = 0; i < items.size(); ++i) {
+        size_t useful = JxlUsefulThreads(items[i]);
+        if (useful >= coreBudget) {
+            schedule.sequential.push_back(i);
+        } else {
+            schedule.concurrent.push_back(i);
+            threads.push_back(useful);
+        }
+    }
+
+    // Longest jobs first, so the tail of the batch is made from the cheap ones
+    std::vector<double> costs(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        costs[i] = JxlEncodingCost(items[i]);
+    }
+    auto byCost = [&costs](size_t a, size_t b) {
+        return costs[a] > costs[b];
+    };
+    std::sort(schedule.sequential.begin(), schedule.sequential.end(), byCost);
+    std::sort(schedule.concurrent.begin(), schedule.concurrent.end(), byCost);
+
+    if (!threads.empty()) {
+        std::nth_element(threads.begin(), threads.begin() + threads.size() / 2, threads.end());
+        size_t median = threads[threads.size() / 2];
+        schedule.threadsPerImage = std::clamp(median, static_cast<size_t>(1), coreBudget);
+        schedule.concurrentImages = std::max(coreBudget / schedule.threadsPerImage, static_cast<size_t>(1));
+        schedule.concurrentImages = std::min(schedule.concurrentImages, schedule.concurrent.size());
+    }
+    return schedule;
+}
+
+static size_t JxlRunnerThreads(size_t threads) {
+    // Thread runner with zero workers runs everything on the calling thread
+    return threads <= 1 ? 0 : threads;
+}
+
+bool EncodeJxlBatch(std::vector<JxlBatchEncodingItem>& items, size_t coreBudget) {
+    if (coreBudget == 0) {
+        coreBudget = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    JxlBatchSchedule schedule = PlanJxlBatch(items, coreBudget);
+
+    if (!schedule.sequential.empty()) {
+        JxlEncoderSession session(JxlRunnerThreads(coreBudget));
+        for (size_t index : schedule.sequential) {
+            auto& item = items[index];
+            item.success = session.encode(item.pixels, item.xsize, item.ysize, item.params, &item.compressed);
+        }
+    }
+
+    if (!schedule.concurrent.empty()) {
+        std::atomic<size_t> next(0);
+        auto worker = [&]() {
+            try {
+                JxlEncoderSession session(JxlRunnerThreads(schedule.threadsPerImage));
+                for (;;) {
+                    size_t position = next.fetch_add(1);
+                    if (position >= schedule.concurrent.size()) {
+                        break;
+                    }
+                    auto& item = items[schedule.concurrent[position]];
+                    try {
+                        item.success = session.encode(item.pixels, item.xsize, item.ysize, item.params, &item.compressed);
+                    } catch (std::bad_alloc& err) {
+                        item.success = false;
+                    }
+                }
+            } catch (EncoderSessionError& err) {
+                // Items that were not taken by this worker are left to the others
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < schedule.concurrentImages; ++i) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : workers) {
+            thread.join();
+        }
+    }
+
+    return std::all_of(items.begin(), items.end(), [](const JxlBatchEncodingItem& item) {
+        return item.success;
+    });
+}
@@ -0,0 +1,72 @@
+//
+//  JxlBatchEncoder.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlBatchEncoder_hpp
+#define JxlBatchEncoder_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <vector>
+#include "JxlDefinitions.h"
+#include "JxlWorker.hpp"
+
+struct JxlBatchEncodingItem {
+    std::vector<uint8_t> pixels;
+    uint32_t xsize;
+    uint32_t ysize;
+    JxlEncodingParams params;
+    std::vector<uint8_t> compressed;
+    bool success = false;
+};
+
+struct JxlBatchSchedule {
+    // Images that are large enough to saturate all cores, encoded one by one
+    std::vector<size_t> sequential;
+    // Images that are encoded concurrently, each with threadsPerImage threads
+    std::vector<size_t> concurrent;
+    size_t concurrentImages = 1;
+    size_t threadsPerImage = 1;
+};
+
+/**
+ * Decides how many images should be encoded at once and how many threads each one gets.
+ * libjxl parallelizes over 256x256 groups, so small images can't use many threads,
+ * while higher efforts contain more serial work per image.
+ *
+ * @param items images to encode
+ * @param coreBudget total number of threads that may be used, 0 means hardware concurrency
+ */
+JxlBatchSchedule PlanJxlBatch(const std::vector<JxlBatchEncodingItem>& items, size_t coreBudget);
+
+/**
+ * Encodes all the items using provided core budget.
+ * @return true if every item were successfully encoded, result of each item is stored in success
+ */
+bool EncodeJxlBatch(std::vector<JxlBatchEncodingItem>& items, size_t coreBudget);
+
+#endif
+
+#endif /* JxlBatchEncoder_hpp */
@@ -39,7 +39,9 @@ enum JxlCompressionOption {
 enum JxlDecodingPixelFormat {
     optimal = 1,
     r8 = 2,
-    float16 = 3
+    float16 = 3,
+    // Animated decoding only
+    u16 = 4
 };
 
 enum JxlEncodingPixelFormat {
@@ -47,6 +49,28 @@ enum JxlEncodingPixelFormat {
     efloat16 = 2
 };
 
+// Predefined color encoding, declared without an ICC profile. Rec.2100 spaces are HDR with
+// BT.2020 primaries and the PQ or HLG transfer
+enum JxlEncodingColorSpace {
+    srgb = 1,
+    displayP3 = 2,
+    rec2020 = 3,
+    linearSRGB = 4,
+    rec2100PQ = 5,
+    rec2100HLG = 6
+};
+
+enum JxlAnimationCompositing {
+    compositeAuto = 1,
+    compositeLibjxl = 2,
+    compositeIncremental = 3
+};
+
+enum JxlFrameCachePolicy {
+    cacheLRU = 1,
+    cacheWholeLoop = 2
+};
+
 enum JxlExposedOrientation {
     Identity = 1,
     FlipHorizontal = 2,
@@ -0,0 +1,81 @@
+//
+//  JxlEncodeStatistics.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlEncodeStatistics.hpp"
+#include <time.h>
+#include <sys/resource.h>
+#include <algorithm>
+
+static uint64_t ThreadCpuNs() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+double JxlStageTimer::threadCpuMs() {
+    return static_cast<double>(ThreadCpuNs()) / 1000000.0;
+}
+
+JxlParallelRetCode JxlMeasuringRunner::run(void* runnerOpaque, void* jpegxlOpaque, JxlParallelRunInit init,
+                                           JxlParallelRunFunction func, uint32_t startRange, uint32_t endRange) {
+    auto* self = static_cast<JxlMeasuringRunner*>(runnerOpaque);
+    Task task = { self, jpegxlOpaque, init, func, std::this_thread::get_id() };
+    return self->runner(self->runnerOpaque, &task, initTask, runTask, startRange, endRange);
+}
+
+JxlParallelRetCode JxlMeasuringRunner::initTask(void* opaque, size_t numThreads) {
+    auto* task = static_cast<Task*>(opaque);
+    return task->init(task->opaque, numThreads);
+}
+
+void JxlMeasuringRunner::runTask(void* opaque, uint32_t value, size_t threadId) {
+    auto* task = static_cast<Task*>(opaque);
+    // Runner without workers runs tasks on the caller, whose stage timer already counts them
+    if (std::this_thread::get_id() == task->caller) {
+        task->func(task->opaque, value, threadId);
+        return;
+    }
+    const uint64_t start = ThreadCpuNs();
+    task->func(task->opaque, value, threadId);
+    task->owner->taskCpuNs.fetch_add(ThreadCpuNs() - start, std::memory_order_relaxed);
+}
+
+void JxlEncodeStatistics::finish(size_t threads) {
+    numThreads = threads;
+    // Caller thread also runs the work when runner has no workers
+    const double available = totalWallMs() * static_cast<double>(threads > 0 ? threads : 1);
+    threadUtilization = available > 0 ? std::min(totalCpuMs() / available, 1.0) : 0;
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if __APPLE__
+        peakMemoryBytes = static_cast<size_t>(usage.ru_maxrss);
+#else
+        peakMemoryBytes = static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+}
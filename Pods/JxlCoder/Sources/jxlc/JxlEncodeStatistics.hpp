@@ -0,0 +1,143 @@
+//
+//  JxlEncodeStatistics.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlEncodeStatistics_hpp
+#define JxlEncodeStatistics_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <jxl/stats.h>
+#include <jxl/parallel_runner.h>
+
+struct JxlStageTiming {
+    double wallMs = 0;
+    // CPU time of the encoding thread and of the encoder tasks run on the measuring runner,
+    // other threads of the process are not counted
+    double cpuMs = 0;
+};
+
+// Every encode that receives the statistics resets them first, a reused object holds only the last run
+struct JxlEncodeStatistics {
+    // Basic info, color encoding, frame settings and channel analysis
+    JxlStageTiming setup;
+    JxlStageTiming addFrame;
+    JxlStageTiming processOutput;
+
+    // Raw values of JxlEncoderCollectStats, bits for *_BITS keys and counts for the rest
+    size_t values[JXL_ENC_NUM_STATS] = {};
+    size_t compressedBytes = 0;
+    size_t numThreads = 0;
+    // CPU time over the wall time available to all threads, 0...1
+    double threadUtilization = 0;
+    // Peak resident memory of the process after encoding
+    size_t peakMemoryBytes = 0;
+
+    size_t sectionBytes(JxlEncoderStatsKey key) const {
+        return (values[key] + 7) / 8;
+    }
+
+    double totalWallMs() const {
+        return setup.wallMs + addFrame.wallMs + processOutput.wallMs;
+    }
+
+    double totalCpuMs() const {
+        return setup.cpuMs + addFrame.cpuMs + processOutput.cpuMs;
+    }
+
+    void finish(size_t threads);
+};
+
+/**
+ * Forwards libjxl tasks to another runner and sums the CPU time of each task on the thread
+ * that ran it. Process CPU time would also count encodes running concurrently in other sessions.
+ */
+class JxlMeasuringRunner {
+public:
+    JxlMeasuringRunner(JxlParallelRunner runner, void* runnerOpaque): runner(runner), runnerOpaque(runnerOpaque) {}
+
+    // Attach with JxlEncoderSetParallelRunner(enc, JxlMeasuringRunner::run, &measuringRunner)
+    static JxlParallelRetCode run(void* runnerOpaque, void* jpegxlOpaque, JxlParallelRunInit init,
+                                  JxlParallelRunFunction func, uint32_t startRange, uint32_t endRange);
+
+    // Total of tasks run on other threads than the one that started them, that one is measured by its stage
+    double getTaskCpuMs() const {
+        return static_cast<double>(taskCpuNs.load(std::memory_order_relaxed)) / 1000000.0;
+    }
+
+private:
+    struct Task {
+        JxlMeasuringRunner* owner;
+        void* opaque;
+        JxlParallelRunInit init;
+        JxlParallelRunFunction func;
+        std::thread::id caller;
+    };
+
+    static JxlParallelRetCode initTask(void* opaque, size_t numThreads);
+    static void runTask(void* opaque, uint32_t value, size_t threadId);
+
+    JxlParallelRunner runner;
+    void* runnerOpaque;
+    std::atomic<uint64_t> taskCpuNs = 0;
+};
+
+/**
+ * Measures wall time and CPU time of the calling thread from construction until it's destroyed
+ * and adds it to the stage, with the tasks the runner ran meanwhile. Does nothing when stage is null.
+ */
+class JxlStageTimer {
+public:
+    JxlStageTimer(JxlStageTiming* stage, const JxlMeasuringRunner* runner = nullptr): stage(stage), runner(runner) {
+        if (stage) {
+            wallStart = std::chrono::steady_clock::now();
+            cpuStart = threadCpuMs() + (runner ? runner->getTaskCpuMs() : 0);
+        }
+    }
+
+    ~JxlStageTimer() {
+        if (stage) {
+            auto wall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart);
+            stage->wallMs += wall.count();
+            stage->cpuMs += threadCpuMs() + (runner ? runner->getTaskCpuMs() : 0) - cpuStart;
+        }
+    }
+
+    static double threadCpuMs();
+
+private:
+    JxlStageTiming* stage;
+    const JxlMeasuringRunner* runner;
+    std::chrono::steady_clock::time_point wallStart;
+    double cpuStart = 0;
+};
+
+#endif
+
+#endif /* JxlEncodeStatistics_hpp */
@@ -0,0 +1,83 @@
+//
+//  JxlEncoderSession.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlEncoderSession.hpp"
+
+bool JxlEncoderSession::encode(const std::vector<uint8_t>& pixels, const uint32_t xsize, const uint32_t ysize,
+                               const JxlEncodingParams& params, std::vector<uint8_t>* compressed,
+                               JxlEncodeStatistics* stats) {
+    JxlImageView view;
+    view.data = pixels.data();
+    view.width = xsize;
+    view.height = ysize;
+    view.components = params.colorspace == rgba ? 4 : 3;
+    if (pixels.size() < static_cast<size_t>(xsize) * ysize * view.components) {
+        return false;
+    }
+    return encode(view, params, compressed, stats);
+}
+
+bool JxlEncoderSession::encode(const JxlImageView& view, const JxlEncodingParams& params,
+                               std::vector<uint8_t>* compressed, JxlEncodeStatistics* stats) {
+    std::lock_guard guard(lock);
+    // Reset also detaches parallel runner, so it must be attached again
+    JxlEncoderReset(enc.get());
+    // Tasks are measured only when statistics are requested
+    JxlMeasuringRunner measuringRunner(JxlThreadParallelRunner, runner.get());
+    if (JXL_ENC_SUCCESS != JxlEncoderSetParallelRunner(enc.get(),
+                                                       stats ? JxlMeasuringRunner::run : JxlThreadParallelRunner,
+                                                       stats ? static_cast<void*>(&measuringRunner) : runner.get())) {
+        return false;
+    }
+    if (!EncodeJxlWithEncoder(enc.get(), view, compressed, params, &scratch, stats, &measuringRunner)) {
+        return false;
+    }
+    if (stats) {
+        stats->finish(numThreads);
+    }
+    return true;
+}
+
+std::unique_ptr<JxlEncoderSession> JxlEncoderSessionPool::acquire() {
+    {
+        std::lock_guard guard(lock);
+        if (!idle.empty()) {
+            auto session = std::move(idle.back());
+            idle.pop_back();
+            return session;
+        }
+    }
+    return std::make_unique<JxlEncoderSession>(threadsPerSession);
+}
+
+void JxlEncoderSessionPool::release(std::unique_ptr<JxlEncoderSession> session) {
+    if (!session) {
+        return;
+    }
+    std::lock_guard guard(lock);
+    if (idle.size() < maxIdleSessions) {
+        idle.push_back(std::move(session));
+    }
+}
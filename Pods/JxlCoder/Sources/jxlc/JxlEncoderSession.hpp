@@ -0,0 +1,115 @@
+//
+//  JxlEncoderSession.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlEncoderSession_hpp
+#define JxlEncoderSession_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <jxl/encode.h>
+#include <jxl/encode_cxx.h>
+#include <jxl/thread_parallel_runner.h>
+#include <jxl/thread_parallel_runner_cxx.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include "JxlDefinitions.h"
+#include "JxlWorker.hpp"
+
+class EncoderSessionError : public std::exception {
+public:
+    EncoderSessionError(const std::string& message) : errorMessage(message) {}
+
+    const char* what() const noexcept override {
+        return errorMessage.c_str();
+    }
+
+private:
+    std::string errorMessage;
+};
+
+/**
+ * Keeps encoder and it's thread pool alive between encodings.
+ * Encoder is reset with JxlEncoderReset after each image so no threads are spawned
+ * and no encoder allocated for the next image.
+ * Session may be used from any thread, but only one encoding runs at the time.
+ */
+class JxlEncoderSession {
+public:
+    JxlEncoderSession(size_t numThreads = JxlThreadParallelRunnerDefaultNumWorkerThreads()): numThreads(numThreads) {
+        enc = JxlEncoderMake(nullptr);
+        runner = JxlThreadParallelRunnerMake(nullptr, numThreads);
+        if (!enc || !runner) {
+            std::string str = "Cannot initialize encoder";
+            throw EncoderSessionError(str);
+        }
+    }
+
+    bool encode(const std::vector<uint8_t>& pixels, const uint32_t xsize, const uint32_t ysize,
+                const JxlEncodingParams& params, std::vector<uint8_t>* compressed,
+                JxlEncodeStatistics* stats = nullptr);
+    bool encode(const JxlImageView& view, const JxlEncodingParams& params,
+                std::vector<uint8_t>* compressed, JxlEncodeStatistics* stats = nullptr);
+
+    size_t getNumberOfThreads() {
+        return numThreads;
+    }
+
+private:
+    const size_t numThreads;
+    JxlEncoderPtr enc;
+    JxlThreadParallelRunnerPtr runner;
+    // Pixels with pruned channels, kept to avoid allocation on every image
+    std::vector<uint8_t> scratch;
+    std::mutex lock;
+};
+
+/**
+ * Thread safe pool of the encoder sessions.
+ * Acquired session is owned by the caller and must be returned with release when it's done.
+ */
+class JxlEncoderSessionPool {
+public:
+    JxlEncoderSessionPool(size_t maxIdleSessions = 4,
+                          size_t threadsPerSession = JxlThreadParallelRunnerDefaultNumWorkerThreads()):
+    maxIdleSessions(maxIdleSessions), threadsPerSession(threadsPerSession) {
+
+    }
+
+    std::unique_ptr<JxlEncoderSession> acquire();
+    void release(std::unique_ptr<JxlEncoderSession> session);
+
+private:
+    const size_t maxIdleSessions;
+    const size_t threadsPerSession;
+    std::vector<std::unique_ptr<JxlEncoderSession>> idle;
+    std::mutex lock;
+};
+
+#endif
+
+#endif /* JxlEncoderSession_hpp */
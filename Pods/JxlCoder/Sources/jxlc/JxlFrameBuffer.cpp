@@ -0,0 +1,117 @@
+//
+//  JxlFrameBuffer.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlFrameBuffer.hpp"
+#include <new>
+
+// State shared by the pool and its outstanding buffers, whoever goes last deletes it
+struct JxlFrameBuffer::Shared {
+    std::mutex lock;
+    std::vector<Node*> available;
+    size_t bufferSize;
+    size_t capacity;
+    size_t outstanding = 0;
+    bool closed = false;
+};
+
+void JxlFrameBuffer::release() {
+    if (!node) {
+        return;
+    }
+    Node* released = node;
+    node = nullptr;
+    if (released->references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    Shared* owner = released->owner;
+    bool deleteOwner = false;
+    {
+        std::lock_guard guard(owner->lock);
+        owner->outstanding -= 1;
+        if (!owner->closed && owner->available.size() < owner->capacity) {
+            released->references.store(1, std::memory_order_relaxed);
+            owner->available.push_back(released);
+            released = nullptr;
+        }
+        deleteOwner = owner->closed && owner->outstanding == 0;
+    }
+    delete released;
+    if (deleteOwner) {
+        delete owner;
+    }
+}
+
+JxlFrameBufferPool::JxlFrameBufferPool(size_t bufferSize, size_t capacity) {
+    shared = new JxlFrameBuffer::Shared();
+    shared->bufferSize = bufferSize;
+    shared->capacity = capacity;
+    shared->available.reserve(capacity);
+}
+
+JxlFrameBufferPool::~JxlFrameBufferPool() {
+    bool deleteShared = false;
+    {
+        std::lock_guard guard(shared->lock);
+        shared->closed = true;
+        for (auto node : shared->available) {
+            delete node;
+        }
+        shared->available.clear();
+        deleteShared = shared->outstanding == 0;
+    }
+    if (deleteShared) {
+        delete shared;
+    }
+}
+
+JxlFrameBuffer JxlFrameBufferPool::acquire() {
+    JxlFrameBuffer::Node* node = nullptr;
+    {
+        std::lock_guard guard(shared->lock);
+        shared->outstanding += 1;
+        if (!shared->available.empty()) {
+            node = shared->available.back();
+            shared->available.pop_back();
+        }
+    }
+    if (node) {
+        // Holder may have shrunk the storage, capacity is kept so this doesn't allocate
+        node->pixels.resize(shared->bufferSize);
+    }
+    if (!node) {
+        try {
+            node = new JxlFrameBuffer::Node();
+            node->owner = shared;
+            node->pixels.resize(shared->bufferSize);
+        } catch (std::bad_alloc& err) {
+            delete node;
+            std::lock_guard guard(shared->lock);
+            shared->outstanding -= 1;
+            throw;
+        }
+    }
+    return JxlFrameBuffer(node);
+}
@@ -0,0 +1,135 @@
+//
+//  JxlFrameBuffer.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlFrameBuffer_hpp
+#define JxlFrameBuffer_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+class JxlFrameBufferPool;
+
+/**
+ * Reference counted handle to a pooled pixels buffer. Copying only bumps the counter,
+ * the buffer returns to its pool when the last handle is gone, so frames can be handed
+ * to a renderer without copying pixels. Buffers may outlive the pool.
+ */
+class JxlFrameBuffer {
+public:
+    JxlFrameBuffer() {}
+
+    JxlFrameBuffer(const JxlFrameBuffer& other): node(other.node) {
+        retain();
+    }
+
+    JxlFrameBuffer(JxlFrameBuffer&& other) noexcept: node(other.node) {
+        other.node = nullptr;
+    }
+
+    JxlFrameBuffer& operator=(const JxlFrameBuffer& other) {
+        if (this != &other) {
+            release();
+            node = other.node;
+            retain();
+        }
+        return *this;
+    }
+
+    JxlFrameBuffer& operator=(JxlFrameBuffer&& other) noexcept {
+        if (this != &other) {
+            release();
+            node = other.node;
+            other.node = nullptr;
+        }
+        return *this;
+    }
+
+    ~JxlFrameBuffer() {
+        release();
+    }
+
+    uint8_t* data() {
+        return node ? node->pixels.data() : nullptr;
+    }
+
+    size_t size() const {
+        return node ? node->pixels.size() : 0;
+    }
+
+    // Storage is reused between frames, resizing to the same size never allocates
+    std::vector<uint8_t>& storage() {
+        return node->pixels;
+    }
+
+private:
+    friend class JxlFrameBufferPool;
+
+    struct Shared;
+
+    struct Node {
+        std::vector<uint8_t> pixels;
+        std::atomic<int> references = 1;
+        Shared* owner;
+    };
+
+    explicit JxlFrameBuffer(Node* node): node(node) {}
+
+    void retain() {
+        if (node) {
+            node->references.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void release();
+
+    Node* node = nullptr;
+};
+
+/**
+ * Keeps released frame buffers for reuse, decoding a frame of the same size
+ * doesn't touch the heap once the pool is warm.
+ */
+class JxlFrameBufferPool {
+public:
+    JxlFrameBufferPool(size_t bufferSize, size_t capacity = 4);
+    ~JxlFrameBufferPool();
+
+    JxlFrameBufferPool(const JxlFrameBufferPool&) = delete;
+    JxlFrameBufferPool& operator=(const JxlFrameBufferPool&) = delete;
+
+    JxlFrameBuffer acquire();
+
+private:
+    JxlFrameBuffer::Shared* shared;
+};
+
+#endif
+
+#endif /* JxlFrameBuffer_hpp */
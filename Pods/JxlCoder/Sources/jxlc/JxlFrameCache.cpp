@@ -0,0 +1,242 @@
+//
+//  JxlFrameCache.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlFrameCache.hpp"
+#include <cstring>
+#include <algorithm>
+
+static inline uint32_t LoadPixel(const uint8_t* pixels, size_t index) {
+    uint32_t value;
+    memcpy(&value, pixels + index * 4, sizeof(uint32_t));
+    return value;
+}
+
+/**
+ * Run length coding of 32 bit pixels: control byte below 128 is followed by control + 1
+ * literal pixels, control of 128 or above repeats the following pixel control - 126 times
+ */
+static void PackPixels(const uint8_t* pixels, size_t count, std::vector<uint8_t>& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < count) {
+        const uint32_t value = LoadPixel(pixels, i);
+        size_t run = 1;
+        while (i + run < count && run < 129 && LoadPixel(pixels, i + run) == value) {
+            run += 1;
+        }
+        if (run >= 2) {
+            out.push_back(static_cast<uint8_t>(126 + run));
+            out.insert(out.end(), pixels + i * 4, pixels + i * 4 + 4);
+            i += run;
+            continue;
+        }
+        const size_t start = i;
+        size_t literals = 0;
+        while (i < count && literals < 128) {
+            if (i + 1 < count && LoadPixel(pixels, i + 1) == LoadPixel(pixels, i)) {
+                break;
+            }
+            i += 1;
+            literals += 1;
+        }
+        out.push_back(static_cast<uint8_t>(literals - 1));
+        out.insert(out.end(), pixels + start * 4, pixels + (start + literals) * 4);
+    }
+}
+
+static void UnpackPixels(const std::vector<uint8_t>& packed, uint8_t* pixels) {
+    size_t i = 0;
+    uint8_t* dst = pixels;
+    while (i < packed.size()) {
+        const uint8_t control = packed[i++];
+        if (control < 128) {
+            const size_t length = (control + 1) * 4;
+            memcpy(dst, packed.data() + i, length);
+            dst += length;
+            i += length;
+        } else {
+            const size_t run = control - 126;
+            for (size_t k = 0; k < run; ++k) {
+                memcpy(dst, packed.data() + i, 4);
+                dst += 4;
+            }
+            i += 4;
+        }
+    }
+}
+
+static void DownscalePixels(const uint8_t* pixels, uint32_t width, uint32_t height, std::vector<uint8_t>& out) {
+    const uint32_t dstWidth = (width + 1) / 2;
+    const uint32_t dstHeight = (height + 1) / 2;
+    out.resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
+    for (uint32_t y = 0; y < dstHeight; ++y) {
+        const uint32_t y0 = y * 2;
+        const uint32_t y1 = std::min(y0 + 1, height - 1);
+        for (uint32_t x = 0; x < dstWidth; ++x) {
+            const uint32_t x0 = x * 2;
+            const uint32_t x1 = std::min(x0 + 1, width - 1);
+            uint8_t* dst = out.data() + (static_cast<size_t>(y) * dstWidth + x) * 4;
+            for (int c = 0; c < 4; ++c) {
+                const uint32_t sum = pixels[(static_cast<size_t>(y0) * width + x0) * 4 + c] +
+                                     pixels[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+                                     pixels[(static_cast<size_t>(y1) * width + x0) * 4 + c] +
+                                     pixels[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+                dst[c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+static void UpscalePixels(const std::vector<uint8_t>& scaled, uint32_t width, uint32_t height, uint8_t* pixels) {
+    const uint32_t scaledWidth = (width + 1) / 2;
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* src = scaled.data() + static_cast<size_t>(y / 2) * scaledWidth * 4;
+        uint8_t* dst = pixels + static_cast<size_t>(y) * width * 4;
+        for (uint32_t x = 0; x < width; ++x) {
+            memcpy(dst + x * 4, src + (x / 2) * 4, 4);
+        }
+    }
+}
+
+void JxlFrameCache::pack(Entry& entry) {
+    if (entry.storage != raw) {
+        return;
+    }
+    std::vector<uint8_t> packedData;
+    PackPixels(entry.data.data(), static_cast<size_t>(width) * height, packedData);
+    // Packing noisy content doesn't pay off, it is then either downscaled or kept as is
+    if (packedData.size() < entry.data.size() / 4 * 3) {
+        entry.data = std::move(packedData);
+        entry.storage = packed;
+    } else if (allowDownscale) {
+        std::vector<uint8_t> scaled;
+        DownscalePixels(entry.data.data(), width, height, scaled);
+        entry.data = std::move(scaled);
+        entry.storage = downscaled;
+    }
+}
+
+void JxlFrameCache::evict() {
+    const int frame = recent.back();
+    recent.pop_back();
+    auto entry = entries.find(frame);
+    used -= entry->second.data.size();
+    entries.erase(entry);
+}
+
+bool JxlFrameCache::makeRoom(size_t bytes) {
+    if (bytes > budget) {
+        return false;
+    }
+    // Least recently used frames are packed first
+    for (auto it = recent.rbegin(); it != recent.rend() && used + bytes > budget; ++it) {
+        Entry& entry = entries[*it];
+        if (entry.storage != raw) {
+            continue;
+        }
+        used -= entry.data.size();
+        pack(entry);
+        used += entry.data.size();
+    }
+    if (used + bytes <= budget) {
+        return true;
+    }
+    if (policy == cacheWholeLoop) {
+        return false;
+    }
+    while (used + bytes > budget && !recent.empty()) {
+        evict();
+    }
+    return true;
+}
+
+bool JxlFrameCache::get(int frame, std::vector<uint8_t>& pixels, bool acceptLossy, bool* lossy) {
+    std::lock_guard guard(lock);
+    auto it = entries.find(frame);
+    if (it == entries.end() || (it->second.storage == downscaled && !acceptLossy)) {
+        misses += 1;
+        return false;
+    }
+    hits += 1;
+    Entry& entry = it->second;
+    if (lossy) {
+        *lossy = entry.storage == downscaled;
+    }
+    recent.splice(recent.begin(), recent, entry.recent);
+
+    if (entry.storage == raw) {
+        pixels.assign(entry.data.begin(), entry.data.end());
+        return true;
+    }
+    pixels.resize(static_cast<size_t>(width) * height * 4);
+    if (entry.storage == packed) {
+        UnpackPixels(entry.data, pixels.data());
+    } else {
+        UpscalePixels(entry.data, width, height, pixels.data());
+    }
+    return true;
+}
+
+void JxlFrameCache::put(int frame, const std::vector<uint8_t>& pixels) {
+    std::lock_guard guard(lock);
+    if (pixels.size() != static_cast<size_t>(width) * height * 4) {
+        return;
+    }
+    // Lossy entry stays, exact requests of the frame keep decoding it
+    auto it = entries.find(frame);
+    if (it != entries.end()) {
+        recent.splice(recent.begin(), recent, it->second.recent);
+        return;
+    }
+
+    Entry entry = { .storage = raw, .data = pixels, .recent = recent.end() };
+    if (used + entry.data.size() > budget) {
+        pack(entry);
+    }
+    if (!makeRoom(entry.data.size())) {
+        return;
+    }
+    recent.push_front(frame);
+    entry.recent = recent.begin();
+    used += entry.data.size();
+    entries.emplace(frame, std::move(entry));
+}
+
+void JxlFrameCache::setBudget(size_t newBudget) {
+    std::lock_guard guard(lock);
+    budget = newBudget;
+    if (!makeRoom(0)) {
+        while (used > budget && !recent.empty()) {
+            evict();
+        }
+    }
+}
+
+void JxlFrameCache::clear() {
+    std::lock_guard guard(lock);
+    entries.clear();
+    recent.clear();
+    used = 0;
+}
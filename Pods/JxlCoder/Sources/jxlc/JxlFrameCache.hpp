@@ -0,0 +1,111 @@
+//
+//  JxlFrameCache.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlFrameCache_hpp
+#define JxlFrameCache_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include "JxlDefinitions.h"
+
+/**
+ * Decoded RGBA8 frames kept within a byte budget. Frames are stored as is while they fit,
+ * when the budget is reached the cache packs frames with run length coding of pixels,
+ * optionally falls back to half resolution, and only then evicts. Half resolution frames
+ * are lossy and come back upscaled only to callers that accept it.
+ * LRU evicts the least recently used frame, whole loop keeps already cached frames
+ * and stops admitting new ones, which avoids sequential loop thrashing LRU.
+ */
+class JxlFrameCache {
+public:
+    JxlFrameCache(uint32_t width, uint32_t height, size_t budget,
+                  JxlFrameCachePolicy policy = cacheWholeLoop, bool allowDownscale = false):
+        width(width), height(height), budget(budget), policy(policy), allowDownscale(allowDownscale) {
+    }
+
+    // Lossy frames are misses unless accepted, lossy then tells whether the frame was one
+    bool get(int frame, std::vector<uint8_t>& pixels, bool acceptLossy = false, bool* lossy = nullptr);
+    void put(int frame, const std::vector<uint8_t>& pixels);
+
+    // Shrinks the budget, e.g. on memory warning, packing and evicting frames to fit
+    void setBudget(size_t newBudget);
+
+    void clear();
+
+    size_t getUsedBytes() {
+        std::lock_guard guard(lock);
+        return used;
+    }
+
+    uint64_t getHits() {
+        std::lock_guard guard(lock);
+        return hits;
+    }
+
+    uint64_t getMisses() {
+        std::lock_guard guard(lock);
+        return misses;
+    }
+
+private:
+    enum Storage {
+        raw = 1,
+        packed = 2,
+        downscaled = 3
+    };
+
+    struct Entry {
+        Storage storage;
+        std::vector<uint8_t> data;
+        std::list<int>::iterator recent;
+    };
+
+    void pack(Entry& entry);
+    bool makeRoom(size_t bytes);
+    void evict();
+
+    uint32_t width;
+    uint32_t height;
+    size_t budget;
+    JxlFrameCachePolicy policy;
+    bool allowDownscale;
+    size_t used = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // Most recently used at the front
+    std::list<int> recent;
+    std::unordered_map<int, Entry> entries;
+    std::mutex lock;
+};
+
+#endif
+
+#endif /* JxlFrameCache_hpp */
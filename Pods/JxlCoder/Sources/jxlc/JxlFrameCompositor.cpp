@@ -0,0 +1,275 @@
+//
+//  JxlFrameCompositor.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlFrameCompositor.hpp"
+#include <cstring>
+
+#if __arm64__
+#include <arm_neon.h>
+#endif
+
+static inline uint8_t Div255(uint32_t v) {
+    v += 128;
+    return static_cast<uint8_t>((v + (v >> 8)) >> 8);
+}
+
+static void AddRow(uint8_t* dst, const uint8_t* src, size_t count) {
+    const size_t length = count * 4;
+    size_t x = 0;
+#if __arm64__
+    for (; x + 16 <= length; x += 16) {
+        vst1q_u8(dst + x, vqaddq_u8(vld1q_u8(dst + x), vld1q_u8(src + x)));
+    }
+#endif
+    for (; x < length; ++x) {
+        dst[x] = static_cast<uint8_t>(std::min(dst[x] + src[x], 255));
+    }
+}
+
+static void MulRow(uint8_t* dst, const uint8_t* src, size_t count) {
+    const size_t length = count * 4;
+    size_t x = 0;
+#if __arm64__
+    for (; x + 16 <= length; x += 16) {
+        uint8x16_t b = vld1q_u8(dst + x);
+        uint8x16_t p = vld1q_u8(src + x);
+        uint16x8_t lo = vmull_u8(vget_low_u8(b), vget_low_u8(p));
+        uint16x8_t hi = vmull_high_u8(b, p);
+        vst1q_u8(dst + x, vcombine_u8(vraddhn_u16(lo, vrshrq_n_u16(lo, 8)),
+                                      vraddhn_u16(hi, vrshrq_n_u16(hi, 8))));
+    }
+#endif
+    for (; x < length; ++x) {
+        dst[x] = Div255(dst[x] * src[x]);
+    }
+}
+
+// Color is added weighted by the layer alpha, background alpha is kept
+static void MulAddRow(uint8_t* dst, const uint8_t* src, size_t count) {
+    size_t x = 0;
+#if __arm64__
+    for (; x + 8 <= count; x += 8) {
+        uint8x8x4_t b = vld4_u8(dst + x * 4);
+        uint8x8x4_t p = vld4_u8(src + x * 4);
+        for (int c = 0; c < 3; ++c) {
+            uint16x8_t m = vmull_u8(p.val[c], p.val[3]);
+            b.val[c] = vqadd_u8(b.val[c], vraddhn_u16(m, vrshrq_n_u16(m, 8)));
+        }
+        vst4_u8(dst + x * 4, b);
+    }
+#endif
+    for (; x < count; ++x) {
+        uint8_t* d = dst + x * 4;
+        const uint8_t* s = src + x * 4;
+        for (int c = 0; c < 3; ++c) {
+            d[c] = static_cast<uint8_t>(std::min(d[c] + Div255(s[c] * s[3]), 255));
+        }
+    }
+}
+
+// Non premultiplied "over" operator
+static void BlendRow(uint8_t* dst, const uint8_t* src, size_t count) {
+    size_t x = 0;
+#if __arm64__
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    for (; x + 8 <= count; x += 8) {
+        uint8x8x4_t b = vld4_u8(dst + x * 4);
+        uint8x8x4_t p = vld4_u8(src + x * 4);
+        uint8x8_t pa = p.val[3];
+        uint16x8_t t = vmull_u8(b.val[3], vmvn_u8(pa));
+        uint8x8_t bw = vraddhn_u16(t, vrshrq_n_u16(t, 8));
+        uint8x8_t alpha = vadd_u8(pa, bw);
+        uint16x8_t alpha16 = vmovl_u8(alpha);
+        float32x4_t rLo = vdivq_f32(one, vmaxq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(alpha16))), one));
+        float32x4_t rHi = vdivq_f32(one, vmaxq_f32(vcvtq_f32_u32(vmovl_high_u16(alpha16)), one));
+        for (int c = 0; c < 3; ++c) {
+            uint16x8_t num = vmlal_u8(vmull_u8(p.val[c], pa), b.val[c], bw);
+            float32x4_t lo = vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(num))), rLo);
+            float32x4_t hi = vmulq_f32(vcvtq_f32_u32(vmovl_high_u16(num)), rHi);
+            uint16x8_t q = vcombine_u16(vmovn_u32(vcvtnq_u32_f32(lo)), vmovn_u32(vcvtnq_u32_f32(hi)));
+            b.val[c] = vqmovn_u16(q);
+        }
+        b.val[3] = alpha;
+        vst4_u8(dst + x * 4, b);
+    }
+#endif
+    for (; x < count; ++x) {
+        uint8_t* d = dst + x * 4;
+        const uint8_t* s = src + x * 4;
+        const uint32_t pa = s[3];
+        const uint32_t bw = Div255(d[3] * (255 - pa));
+        const uint32_t alpha = pa + bw;
+        if (alpha == 0) {
+            d[0] = d[1] = d[2] = d[3] = 0;
+            continue;
+        }
+        for (int c = 0; c < 3; ++c) {
+            d[c] = static_cast<uint8_t>(std::min<uint32_t>((s[c] * pa + d[c] * bw + alpha / 2) / alpha, 255));
+        }
+        d[3] = static_cast<uint8_t>(alpha);
+    }
+}
+
+void JxlFrameCompositor::reset() {
+    canvas.assign(static_cast<size_t>(width) * height * 4, 0);
+    for (int i = 0; i < 4; ++i) {
+        references[i].clear();
+        stale[i] = {};
+    }
+    changed = { 0, 0, width, height };
+}
+
+void JxlFrameCompositor::copyRect(uint8_t* dst, const uint8_t* src, const JxlCanvasRect& rect) {
+    if (rect.empty()) {
+        return;
+    }
+    const size_t rowLength = (rect.x1 - rect.x0) * 4;
+    for (uint32_t y = rect.y0; y < rect.y1; ++y) {
+        const size_t offset = (static_cast<size_t>(y) * width + rect.x0) * 4;
+        if (src) {
+            memcpy(dst + offset, src + offset, rowLength);
+        } else {
+            memset(dst + offset, 0, rowLength);
+        }
+    }
+}
+
+void JxlFrameCompositor::markChanged(const JxlCanvasRect& rect, int exceptSlot) {
+    for (int i = 0; i < 4; ++i) {
+        if (i != exceptSlot) {
+            stale[i].unite(rect);
+        }
+    }
+    changed.unite(rect);
+}
+
+void JxlFrameCompositor::compose(const JxlIndexedLayer& layer, const uint8_t* pixels) {
+    const int source = layer.blendSource & 3;
+
+    JxlCanvasRect area;
+    const int64_t x0 = std::max<int64_t>(layer.cropX0, 0);
+    const int64_t y0 = std::max<int64_t>(layer.cropY0, 0);
+    const int64_t x1 = std::min<int64_t>(static_cast<int64_t>(layer.cropX0) + layer.xsize, width);
+    const int64_t y1 = std::min<int64_t>(static_cast<int64_t>(layer.cropY0) + layer.ysize, height);
+    if (x0 < x1 && y0 < y1) {
+        area = { static_cast<uint32_t>(x0), static_cast<uint32_t>(y0),
+                 static_cast<uint32_t>(x1), static_cast<uint32_t>(y1) };
+    }
+
+    const bool replacesCanvas = layer.blendMode == JXL_BLEND_REPLACE &&
+                                area.x0 == 0 && area.y0 == 0 && area.x1 == width && area.y1 == height;
+
+    // Background is the source slot, canvas has to be brought back only where it differs
+    if (!replacesCanvas && !stale[source].empty()) {
+        const JxlCanvasRect rect = stale[source];
+        copyRect(canvas.data(), references[source].empty() ? nullptr : references[source].data(), rect);
+        stale[source] = {};
+        markChanged(rect, source);
+    }
+
+    if (!area.empty()) {
+        const size_t count = area.x1 - area.x0;
+        for (uint32_t y = area.y0; y < area.y1; ++y) {
+            uint8_t* dst = canvas.data() + (static_cast<size_t>(y) * width + area.x0) * 4;
+            const uint8_t* src = pixels + (static_cast<size_t>(y - layer.cropY0) * layer.xsize + (area.x0 - layer.cropX0)) * 4;
+            switch (layer.blendMode) {
+                case JXL_BLEND_ADD:
+                    AddRow(dst, src, count);
+                    break;
+                case JXL_BLEND_BLEND:
+                    BlendRow(dst, src, count);
+                    break;
+                case JXL_BLEND_MULADD:
+                    MulAddRow(dst, src, count);
+                    break;
+                case JXL_BLEND_MUL:
+                    MulRow(dst, src, count);
+                    break;
+                default:
+                    memcpy(dst, src, count * 4);
+                    break;
+            }
+        }
+        markChanged(area, -1);
+    }
+
+    if (layer.saved) {
+        const int slot = layer.saveAsReference & 3;
+        if (references[slot].empty()) {
+            references[slot].resize(canvas.size(), 0);
+        }
+        copyRect(references[slot].data(), canvas.data(), stale[slot]);
+        stale[slot] = {};
+    }
+}
+
+JxlCanvasRect JxlFrameCompositor::takeChangedRect() {
+    JxlCanvasRect rect = changed;
+    changed = {};
+    return rect;
+}
+
+void JxlFrameCompositor::save(Checkpoint* checkpoint, uint32_t usedSlots) const {
+    checkpoint->canvas = canvas;
+    for (int i = 0; i < 4; ++i) {
+        checkpoint->references[i].clear();
+        checkpoint->stale[i] = {};
+        checkpoint->saved[i] = false;
+        if (!(usedSlots & (1u << i))) {
+            continue;
+        }
+        const JxlCanvasRect& rect = stale[i];
+        checkpoint->stale[i] = rect;
+        checkpoint->saved[i] = !references[i].empty();
+        if (references[i].empty() || rect.empty()) {
+            continue;
+        }
+        const size_t rowLength = (rect.x1 - rect.x0) * 4;
+        checkpoint->references[i].resize(rowLength * (rect.y1 - rect.y0));
+        for (uint32_t y = rect.y0; y < rect.y1; ++y) {
+            memcpy(checkpoint->references[i].data() + (y - rect.y0) * rowLength,
+                   references[i].data() + (static_cast<size_t>(y) * width + rect.x0) * 4, rowLength);
+        }
+    }
+}
+
+void JxlFrameCompositor::restore(const Checkpoint& checkpoint) {
+    canvas = checkpoint.canvas;
+    for (int i = 0; i < 4; ++i) {
+        const JxlCanvasRect& rect = checkpoint.stale[i];
+        stale[i] = rect;
+        if (!checkpoint.saved[i]) {
+            references[i].clear();
+            continue;
+        }
+        references[i] = canvas;
+        const size_t rowLength = (rect.x1 - rect.x0) * 4;
+        for (uint32_t y = rect.y0; y < rect.y1; ++y) {
+            memcpy(references[i].data() + (static_cast<size_t>(y) * width + rect.x0) * 4,
+                   checkpoint.references[i].data() + (y - rect.y0) * rowLength, rowLength);
+        }
+    }
+    changed = { 0, 0, width, height };
+}
@@ -0,0 +1,124 @@
+//
+//  JxlFrameCompositor.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlFrameCompositor_hpp
+#define JxlFrameCompositor_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "JxlFrameIndex.hpp"
+
+struct JxlCanvasRect {
+    uint32_t x0 = 0;
+    uint32_t y0 = 0;
+    uint32_t x1 = 0;
+    uint32_t y1 = 0;
+
+    bool empty() const {
+        return x0 >= x1 || y0 >= y1;
+    }
+
+    void unite(const JxlCanvasRect& other) {
+        if (other.empty()) {
+            return;
+        }
+        if (empty()) {
+            *this = other;
+            return;
+        }
+        x0 = std::min(x0, other.x0);
+        y0 = std::min(y0, other.y0);
+        x1 = std::max(x1, other.x1);
+        y1 = std::max(y1, other.y1);
+    }
+};
+
+/**
+ * Composes layers decoded without libjxl coalescing into a persistent RGBA8 canvas.
+ * Reference slots are kept as full canvases, but only the area where a slot differs
+ * from the canvas is ever copied, so a small layer costs only its own area.
+ */
+class JxlFrameCompositor {
+public:
+    // Reference slots are kept only inside their stale area, elsewhere they equal the canvas
+    struct Checkpoint {
+        std::vector<uint8_t> canvas;
+        // Pixels of the stale area row by row
+        std::vector<uint8_t> references[4];
+        JxlCanvasRect stale[4];
+        // False for a transparent black or an unused slot
+        bool saved[4] = {};
+
+        size_t size() const {
+            size_t bytes = canvas.size();
+            for (int i = 0; i < 4; ++i) {
+                bytes += references[i].size();
+            }
+            return bytes;
+        }
+    };
+
+    JxlFrameCompositor(uint32_t width, uint32_t height): width(width), height(height) {
+        reset();
+    }
+
+    // Clears canvas and all reference slots to transparent black
+    void reset();
+
+    // Blends layer pixels of layer.xsize * layer.ysize RGBA8 onto the canvas, then saves a reference slot when required
+    void compose(const JxlIndexedLayer& layer, const uint8_t* pixels);
+
+    const std::vector<uint8_t>& getCanvas() const {
+        return canvas;
+    }
+
+    // Canvas area changed since the last call
+    JxlCanvasRect takeChangedRect();
+
+    // Slots outside of usedSlots mask are restored equal to the canvas, only valid when nothing reads them later
+    void save(Checkpoint* checkpoint, uint32_t usedSlots = 0xF) const;
+    void restore(const Checkpoint& checkpoint);
+
+private:
+    void copyRect(uint8_t* dst, const uint8_t* src, const JxlCanvasRect& rect);
+    void markChanged(const JxlCanvasRect& rect, int exceptSlot);
+
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> canvas;
+    // Empty slot means transparent black which was never saved
+    std::vector<uint8_t> references[4];
+    // Area where each reference slot differs from the canvas
+    JxlCanvasRect stale[4];
+    JxlCanvasRect changed;
+};
+
+#endif
+
+#endif /* JxlFrameCompositor_hpp */
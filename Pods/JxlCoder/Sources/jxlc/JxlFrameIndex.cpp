@@ -0,0 +1,216 @@
+//
+//  JxlFrameIndex.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlFrameIndex.hpp"
+#include <jxl/decode_cxx.h>
+#include <algorithm>
+
+static bool coversCanvas(const JxlIndexedLayer& layer, const JxlBasicInfo& info) {
+    if (!layer.haveCrop) {
+        return true;
+    }
+    return layer.cropX0 <= 0 && layer.cropY0 <= 0 &&
+           static_cast<int64_t>(layer.cropX0) + layer.xsize >= info.xsize &&
+           static_cast<int64_t>(layer.cropY0) + layer.ysize >= info.ysize;
+}
+
+static bool isComposable(const JxlBlendInfo& blend, int alphaChannel) {
+    if (blend.blendmode == JXL_BLEND_REPLACE) {
+        return true;
+    }
+    // Unclamped blending keeps samples out of range in libjxl, 8-bit composition saturates them
+    if (!blend.clamp) {
+        return false;
+    }
+    const bool alphaWeighted = blend.blendmode == JXL_BLEND_BLEND || blend.blendmode == JXL_BLEND_MULADD;
+    return !alphaWeighted || alphaChannel < 0 || static_cast<int>(blend.alpha) == alphaChannel;
+}
+
+bool JxlFrameIndexScanner::start() {
+    dec = JxlDecoderMake(nullptr);
+    if (!dec) {
+        return false;
+    }
+    // Full image is not subscribed so libjxl skips frame sections using TOC without decoding them
+    if (JXL_DEC_SUCCESS != JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_BASIC_INFO |
+                                                                JXL_DEC_COLOR_ENCODING |
+                                                                JXL_DEC_FRAME)) {
+        return false;
+    }
+    if (JXL_DEC_SUCCESS != JxlDecoderSetCoalescing(dec.get(), JXL_FALSE)) {
+        return false;
+    }
+
+    if (JXL_DEC_SUCCESS != JxlDecoderSetInput(dec.get(), data, size)) {
+        return false;
+    }
+
+    index->iccProfile.clear();
+    index->haveColorEncoding = false;
+    index->layers.clear();
+    index->frames.clear();
+    return true;
+}
+
+bool JxlFrameIndexScanner::scan(size_t frames) {
+    if (complete) {
+        return true;
+    }
+    if (!dec && !start()) {
+        return false;
+    }
+
+    while (index->frames.size() < frames) {
+        JxlDecoderStatus status = JxlDecoderProcessInput(dec.get());
+        if (status == JXL_DEC_BASIC_INFO) {
+            if (JXL_DEC_SUCCESS != JxlDecoderGetBasicInfo(dec.get(), &index->info)) {
+                return false;
+            }
+            alphaChannel = -1;
+            premultipliedAlpha = false;
+            for (uint32_t i = 0; i < index->info.num_extra_channels; ++i) {
+                JxlExtraChannelInfo channel;
+                if (JXL_DEC_SUCCESS != JxlDecoderGetExtraChannelInfo(dec.get(), i, &channel)) {
+                    return false;
+                }
+                if (channel.type == JXL_CHANNEL_ALPHA) {
+                    alphaChannel = static_cast<int>(i);
+                    premultipliedAlpha = channel.alpha_premultiplied == JXL_TRUE;
+                    break;
+                }
+            }
+        } else if (status == JXL_DEC_COLOR_ENCODING) {
+            size_t iccSize;
+            if (JXL_DEC_SUCCESS != JxlDecoderGetICCProfileSize(dec.get(), JXL_COLOR_PROFILE_TARGET_DATA, &iccSize)) {
+                return false;
+            }
+            index->iccProfile.resize(iccSize);
+            if (JXL_DEC_SUCCESS != JxlDecoderGetColorAsICCProfile(dec.get(), JXL_COLOR_PROFILE_TARGET_DATA,
+                                                                  index->iccProfile.data(), index->iccProfile.size())) {
+                return false;
+            }
+            index->haveColorEncoding = JXL_DEC_SUCCESS ==
+                    JxlDecoderGetColorAsEncodedProfile(dec.get(), JXL_COLOR_PROFILE_TARGET_DATA, &index->colorEncoding);
+        } else if (status == JXL_DEC_FRAME) {
+            JxlFrameHeader header;
+            if (JXL_DEC_SUCCESS != JxlDecoderGetFrameHeader(dec.get(), &header)) {
+                return false;
+            }
+
+            // Position is taken from the unprocessed remainder, then the same remainder is handed back
+            size_t remaining = JxlDecoderReleaseInput(dec.get());
+            size_t offset = size - remaining;
+            if (JXL_DEC_SUCCESS != JxlDecoderSetInput(dec.get(), data + offset, remaining)) {
+                return false;
+            }
+
+            // Non zero duration with slot 0 means the frame will never be referenced
+            const bool saved = !header.is_last && !(header.duration != 0 && header.layer_info.save_as_reference == 0);
+
+            const JxlBlendInfo& blend = header.layer_info.blend_info;
+            bool composable = !premultipliedAlpha && isComposable(blend, alphaChannel);
+            for (uint32_t i = 0; i < index->info.num_extra_channels && composable; ++i) {
+                JxlBlendInfo channelBlend;
+                composable = JXL_DEC_SUCCESS == JxlDecoderGetExtraChannelBlendInfo(dec.get(), i, &channelBlend)
+                             && channelBlend.blendmode == blend.blendmode && channelBlend.source == blend.source
+                             && isComposable(channelBlend, alphaChannel);
+            }
+            const JxlIndexedLayer layer = {
+                .offset = offset,
+                .haveCrop = header.layer_info.have_crop == JXL_TRUE,
+                .cropX0 = header.layer_info.crop_x0,
+                .cropY0 = header.layer_info.crop_y0,
+                .xsize = header.layer_info.xsize,
+                .ysize = header.layer_info.ysize,
+                .blendMode = header.layer_info.blend_info.blendmode,
+                .blendSource = header.layer_info.blend_info.source,
+                .saveAsReference = header.layer_info.save_as_reference,
+                .saved = saved,
+                .composable = composable,
+                .duration = header.duration,
+            };
+
+            const int frameNumber = static_cast<int>(index->frames.size());
+            if (!frameOpened) {
+                current = {};
+                current.offset = offset;
+                current.firstLayer = index->layers.size();
+                current.dependsOn = frameNumber;
+                frameOpened = true;
+            }
+
+            // Anything except a full canvas replace is drawn over the content of its source slot
+            if (layer.blendMode != JXL_BLEND_REPLACE || !coversCanvas(layer, index->info)) {
+                const uint32_t slot = layer.blendSource & 3;
+                current.usesReferences |= 1u << slot;
+                if (slotRoot[slot] >= 0) {
+                    current.dependsOn = std::min(current.dependsOn, slotRoot[slot]);
+                }
+            }
+
+            if (layer.saved) {
+                const uint32_t slot = layer.saveAsReference & 3;
+                current.savesReferences |= 1u << slot;
+                slotRoot[slot] = current.dependsOn;
+            }
+
+            index->layers.push_back(layer);
+            current.layersCount += 1;
+
+            if (header.duration != 0 || header.is_last) {
+                const JxlAnimationHeader& animation = index->info.animation;
+                if (index->info.have_animation && animation.tps_numerator) {
+                    current.duration = static_cast<int>(1000.0 * header.duration * animation.tps_denominator / animation.tps_numerator);
+                } else {
+                    current.duration = 0;
+                }
+                current.ticks = header.duration;
+                if (!index->frames.empty()) {
+                    current.startTicks = index->frames.back().startTicks + index->frames.back().ticks;
+                }
+                current.keyframe = current.dependsOn == frameNumber;
+                index->frames.push_back(current);
+                frameOpened = false;
+                if (header.is_last) {
+                    complete = true;
+                    dec.reset();
+                    return true;
+                }
+            }
+        } else if (status == JXL_DEC_SUCCESS) {
+            complete = true;
+            dec.reset();
+            return !index->frames.empty();
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool JxlBuildFrameIndex(const uint8_t* data, size_t size, JxlFrameIndex* index) {
+    JxlFrameIndexScanner scanner(data, size, index);
+    return scanner.scan(SIZE_MAX) && scanner.isComplete();
+}
@@ -0,0 +1,129 @@
+//
+//  JxlFrameIndex.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlFrameIndex_hpp
+#define JxlFrameIndex_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include <jxl/decode.h>
+#include <jxl/decode_cxx.h>
+
+struct JxlIndexedLayer {
+    // Offset in the input right after the layer header
+    size_t offset;
+    bool haveCrop;
+    int32_t cropX0;
+    int32_t cropY0;
+    uint32_t xsize;
+    uint32_t ysize;
+    JxlBlendMode blendMode;
+    // Reference slot used as background for the layer
+    uint32_t blendSource;
+    uint32_t saveAsReference;
+    // Result of blending is stored into saveAsReference slot
+    bool saved;
+    // Blending is reproduced by the own 8-bit compositor: a replace, or a clamped blend the same for all
+    // channels with the alpha in the first alpha channel, and the alpha is not premultiplied
+    bool composable;
+    // Duration in ticks, zero for layers composed into the next frame
+    uint32_t duration;
+};
+
+struct JxlFrameIndexEntry {
+    // Offset in the input of the first layer of the frame
+    size_t offset;
+    size_t firstLayer;
+    size_t layersCount;
+    // Duration in milliseconds
+    int duration;
+    // Exact duration in ticks and the sum of durations of all preceding frames
+    uint32_t ticks;
+    uint64_t startTicks;
+    // Nothing decoded before this frame is required to reconstruct it
+    bool keyframe;
+    // Earliest frame which has to be decoded to reconstruct this one
+    int dependsOn;
+    // Bitmasks of reference slots read and written by the layers of the frame
+    uint32_t usesReferences;
+    uint32_t savesReferences;
+};
+
+struct JxlFrameIndex {
+    JxlBasicInfo info;
+    std::vector<uint8_t> iccProfile;
+    // Encoding of decoded pixels, absent when the image is described only by its ICC profile
+    bool haveColorEncoding;
+    JxlColorEncoding colorEncoding;
+    std::vector<JxlIndexedLayer> layers;
+    // Displayed frames, zero duration layers are grouped with the next frame the same way libjxl coalesces them
+    std::vector<JxlFrameIndexEntry> frames;
+};
+
+/**
+ * Builds the index incrementally: each scan reads frame headers only as far as requested,
+ * so the first frames are available regardless of animation length.
+ * Input must stay valid and unchanged while the scanner is alive.
+ */
+class JxlFrameIndexScanner {
+public:
+    JxlFrameIndexScanner(const uint8_t* data, size_t size, JxlFrameIndex* index): data(data), size(size), index(index) {
+    }
+
+    // Scans until the index has at least frames displayed frames or the end of file, false on broken input
+    bool scan(size_t frames);
+
+    bool isComplete() {
+        return complete;
+    }
+
+private:
+    bool start();
+
+    const uint8_t* data;
+    size_t size;
+    JxlFrameIndex* index;
+    JxlDecoderPtr dec;
+    bool complete = false;
+    // First alpha channel among the extra channels, -1 without alpha
+    int alphaChannel = -1;
+    bool premultipliedAlpha = false;
+    // Earliest frame the content of each reference slot depends on, -1 while the slot is empty
+    int slotRoot[4] = { -1, -1, -1, -1 };
+    JxlFrameIndexEntry current = {};
+    bool frameOpened = false;
+};
+
+/**
+ * Scans all frame headers without decoding pixels and builds the index of displayed frames.
+ */
+bool JxlBuildFrameIndex(const uint8_t* data, size_t size, JxlFrameIndex* index);
+
+#endif
+
+#endif /* JxlFrameIndex_hpp */
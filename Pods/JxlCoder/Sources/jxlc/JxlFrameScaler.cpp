@@ -0,0 +1,233 @@
+//
+//  JxlFrameScaler.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlFrameScaler.hpp"
+#include "ScaleInterpolator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if __arm64__
+#include <arm_neon.h>
+#endif
+
+static const int weightBits = 14;
+
+// Mitchell-Netravali family of cubic filters
+static float BCSpline(float x, float B, float C) {
+    x = std::abs(x);
+    if (x < 1.0f) {
+        return ((12 - 9 * B - 6 * C) * x * x * x + (-18 + 12 * B + 6 * C) * x * x + (6 - 2 * B)) / 6.0f;
+    } else if (x < 2.0f) {
+        return ((-B - 6 * C) * x * x * x + (6 * B + 30 * C) * x * x + (-12 * B - 48 * C) * x + (8 * B + 24 * C)) / 6.0f;
+    }
+    return 0.0f;
+}
+
+static float HannSinc(float x) {
+    constexpr float a = 3.0f;
+    x = std::abs(x);
+    if (x >= a) {
+        return 0.0f;
+    }
+    if (x == 0.0f) {
+        return 1.0f;
+    }
+    const float window = 0.5f + 0.5f * std::cos(float(M_PI) * x / a);
+    return window * std::sin(float(M_PI) * x) / (float(M_PI) * x);
+}
+
+static float KernelSupport(XSampler sampler) {
+    switch (sampler) {
+        case nearest:
+            return 0.5f;
+        case bilinear:
+            return 1.0f;
+        case lanczos:
+        case hann:
+            return 3.0f;
+        default:
+            return 2.0f;
+    }
+}
+
+static float KernelWeight(XSampler sampler, float x) {
+    switch (sampler) {
+        case nearest:
+            return x >= -0.5f && x < 0.5f ? 1.0f : 0.0f;
+        case bilinear:
+            return std::max(0.0f, 1.0f - std::abs(x));
+        case mitchell:
+            return BCSpline(x, 1.0f / 3.0f, 1.0f / 3.0f);
+        case bSpline:
+            return BCSpline(x, 1.0f, 0.0f);
+        case hermite:
+            return BCSpline(x, 0.0f, 0.0f);
+        case lanczos:
+            return LanczosWindow<float>(x, 3.0f);
+        case hann:
+            return HannSinc(x);
+        case cubic:
+        case catmullRom:
+        default:
+            return BCSpline(x, 0.0f, 0.5f);
+    }
+}
+
+JxlFrameScaler::JxlFrameScaler(uint32_t srcWidth, uint32_t srcHeight,
+                               uint32_t dstWidth, uint32_t dstHeight, XSampler sampler):
+    srcWidth(srcWidth), srcHeight(srcHeight), dstWidth(dstWidth), dstHeight(dstHeight), sampler(sampler) {
+    computeFilter(horizontal, srcWidth, dstWidth, sampler);
+    computeFilter(vertical, srcHeight, dstHeight, sampler);
+}
+
+void JxlFrameScaler::computeFilter(Filter& filter, uint32_t srcSize, uint32_t dstSize, XSampler sampler) {
+    const float scale = static_cast<float>(srcSize) / static_cast<float>(dstSize);
+    // Nearest stays a point sample, other kernels are stretched over the downscaled footprint
+    const float filterScale = sampler == nearest ? 1.0f : std::max(scale, 1.0f);
+    const float support = KernelSupport(sampler) * filterScale;
+
+    filter.maxTaps = static_cast<uint32_t>(std::ceil(support)) * 2 + 1;
+    filter.starts.resize(dstSize);
+    filter.taps.resize(dstSize);
+    filter.weights.assign(static_cast<size_t>(dstSize) * filter.maxTaps, 0);
+
+    std::vector<float> weights(filter.maxTaps);
+    for (uint32_t i = 0; i < dstSize; ++i) {
+        const float center = (static_cast<float>(i) + 0.5f) * scale;
+        int first = std::max(static_cast<int>(center - support + 0.5f), 0);
+        int last = std::min(static_cast<int>(center + support + 0.5f), static_cast<int>(srcSize));
+        last = std::max(std::min(last, first + static_cast<int>(filter.maxTaps)), first + 1);
+        if (last > static_cast<int>(srcSize)) {
+            first = static_cast<int>(srcSize) - 1;
+            last = static_cast<int>(srcSize);
+        }
+
+        float sum = 0.0f;
+        const int taps = last - first;
+        for (int k = 0; k < taps; ++k) {
+            weights[k] = KernelWeight(sampler, (static_cast<float>(first + k) - center + 0.5f) / filterScale);
+            sum += weights[k];
+        }
+        if (sum == 0.0f) {
+            // Nearest sample when the kernel misses every pixel
+            std::fill(weights.begin(), weights.begin() + taps, 0.0f);
+            weights[std::min(std::max(static_cast<int>(center) - first, 0), taps - 1)] = 1.0f;
+            sum = 1.0f;
+        }
+
+        int32_t* fixed = filter.weights.data() + static_cast<size_t>(i) * filter.maxTaps;
+        for (int k = 0; k < taps; ++k) {
+            fixed[k] = static_cast<int32_t>(std::lround(weights[k] / sum * (1 << weightBits)));
+        }
+        filter.starts[i] = static_cast<uint32_t>(first);
+        filter.taps[i] = static_cast<uint32_t>(taps);
+    }
+}
+
+static inline uint8_t ClampFixed(int32_t v) {
+    v = (v + (1 << (weightBits - 1))) >> weightBits;
+    return static_cast<uint8_t>(std::min(std::max(v, 0), 255));
+}
+
+void JxlFrameScaler::scaleHorizontal(const uint8_t* src, uint8_t* dst, uint32_t firstRow, uint32_t rows) const {
+    const size_t srcStride = static_cast<size_t>(srcWidth) * 4;
+    const size_t dstStride = static_cast<size_t>(dstWidth) * 4;
+    for (uint32_t y = 0; y < rows; ++y) {
+        const uint8_t* srcRow = src + (firstRow + y) * srcStride;
+        uint8_t* dstRow = dst + y * dstStride;
+        for (uint32_t x = 0; x < dstWidth; ++x) {
+            const uint8_t* pixel = srcRow + static_cast<size_t>(horizontal.starts[x]) * 4;
+            const int32_t* weights = horizontal.weights.data() + static_cast<size_t>(x) * horizontal.maxTaps;
+            const uint32_t taps = horizontal.taps[x];
+#if __arm64__
+            int32x4_t acc = vdupq_n_s32(0);
+            for (uint32_t k = 0; k < taps; ++k) {
+                uint32_t packed;
+                memcpy(&packed, pixel + k * 4, sizeof(packed));
+                int32x4_t value = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(vmovl_u8(vcreate_u8(packed)))));
+                acc = vmlaq_n_s32(acc, value, weights[k]);
+            }
+            uint16x4_t narrow = vqrshrun_n_s32(acc, weightBits);
+            uint8x8_t bytes = vqmovn_u16(vcombine_u16(narrow, narrow));
+            vst1_lane_u32(reinterpret_cast<uint32_t*>(dstRow + x * 4), vreinterpret_u32_u8(bytes), 0);
+#else
+            int32_t r = 0, g = 0, b = 0, a = 0;
+            for (uint32_t k = 0; k < taps; ++k) {
+                const int32_t weight = weights[k];
+                r += pixel[k * 4] * weight;
+                g += pixel[k * 4 + 1] * weight;
+                b += pixel[k * 4 + 2] * weight;
+                a += pixel[k * 4 + 3] * weight;
+            }
+            dstRow[x * 4] = ClampFixed(r);
+            dstRow[x * 4 + 1] = ClampFixed(g);
+            dstRow[x * 4 + 2] = ClampFixed(b);
+            dstRow[x * 4 + 3] = ClampFixed(a);
+#endif
+        }
+    }
+}
+
+void JxlFrameScaler::scaleVertical(const uint8_t* src, uint8_t* dst, uint32_t firstRow) const {
+    const size_t stride = static_cast<size_t>(dstWidth) * 4;
+    for (uint32_t y = 0; y < dstHeight; ++y) {
+        const uint8_t* column = src + (vertical.starts[y] - firstRow) * stride;
+        const int32_t* weights = vertical.weights.data() + static_cast<size_t>(y) * vertical.maxTaps;
+        const uint32_t taps = vertical.taps[y];
+        uint8_t* dstRow = dst + y * stride;
+        size_t x = 0;
+#if __arm64__
+        for (; x + 8 <= stride; x += 8) {
+            int32x4_t lo = vdupq_n_s32(0);
+            int32x4_t hi = vdupq_n_s32(0);
+            for (uint32_t k = 0; k < taps; ++k) {
+                uint16x8_t value = vmovl_u8(vld1_u8(column + k * stride + x));
+                lo = vmlaq_n_s32(lo, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(value))), weights[k]);
+                hi = vmlaq_n_s32(hi, vreinterpretq_s32_u32(vmovl_high_u16(value)), weights[k]);
+            }
+            uint16x8_t narrow = vcombine_u16(vqrshrun_n_s32(lo, weightBits), vqrshrun_n_s32(hi, weightBits));
+            vst1_u8(dstRow + x, vqmovn_u16(narrow));
+        }
+#endif
+        for (; x < stride; ++x) {
+            int32_t acc = 0;
+            for (uint32_t k = 0; k < taps; ++k) {
+                acc += column[k * stride + x] * weights[k];
+            }
+            dstRow[x] = ClampFixed(acc);
+        }
+    }
+}
+
+void JxlFrameScaler::scale(const uint8_t* src, uint8_t* dst) const {
+    // Only source rows some output row reads are resampled horizontally
+    const uint32_t firstRow = vertical.starts.front();
+    const uint32_t lastRow = vertical.starts.back() + vertical.taps.back();
+    thread_local std::vector<uint8_t> intermediate;
+    intermediate.resize(static_cast<size_t>(dstWidth) * 4 * (lastRow - firstRow));
+    scaleHorizontal(src, intermediate.data(), firstRow, lastRow - firstRow);
+    scaleVertical(intermediate.data(), dst, firstRow);
+}
@@ -0,0 +1,89 @@
+//
+//  JxlFrameScaler.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlFrameScaler_hpp
+#define JxlFrameScaler_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include "XScaler.hpp"
+
+/**
+ * Separable RGBA8 resampler for a fixed geometry. Filter taps and fixed point weights
+ * for every output column and row are computed once, so scaling each frame of an
+ * animation is only the two convolution passes. Downscaling widens the kernel
+ * to cover the whole source footprint of an output pixel.
+ */
+class JxlFrameScaler {
+public:
+    JxlFrameScaler(uint32_t srcWidth, uint32_t srcHeight,
+                   uint32_t dstWidth, uint32_t dstHeight, XSampler sampler);
+
+    // Source is srcWidth x srcHeight, destination dstWidth x dstHeight, both tightly packed RGBA8
+    void scale(const uint8_t* src, uint8_t* dst) const;
+
+    bool matches(uint32_t srcWidth, uint32_t srcHeight,
+                 uint32_t dstWidth, uint32_t dstHeight, XSampler sampler) const {
+        return this->srcWidth == srcWidth && this->srcHeight == srcHeight
+               && this->dstWidth == dstWidth && this->dstHeight == dstHeight && this->sampler == sampler;
+    }
+
+    uint32_t getWidth() const {
+        return dstWidth;
+    }
+
+    uint32_t getHeight() const {
+        return dstHeight;
+    }
+
+private:
+    // Taps of one axis, output i reads taps[i] source pixels from starts[i]
+    struct Filter {
+        std::vector<uint32_t> starts;
+        std::vector<uint32_t> taps;
+        // Fixed size stride of maxTaps weights per output
+        std::vector<int32_t> weights;
+        uint32_t maxTaps = 0;
+    };
+
+    static void computeFilter(Filter& filter, uint32_t srcSize, uint32_t dstSize, XSampler sampler);
+    void scaleHorizontal(const uint8_t* src, uint8_t* dst, uint32_t firstRow, uint32_t rows) const;
+    void scaleVertical(const uint8_t* src, uint8_t* dst, uint32_t firstRow) const;
+
+    uint32_t srcWidth;
+    uint32_t srcHeight;
+    uint32_t dstWidth;
+    uint32_t dstHeight;
+    XSampler sampler;
+    Filter horizontal;
+    Filter vertical;
+};
+
+#endif
+
+#endif /* JxlFrameScaler_hpp */
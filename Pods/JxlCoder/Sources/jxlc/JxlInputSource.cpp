@@ -0,0 +1,92 @@
+//
+//  JxlInputSource.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlInputSource.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+
+std::shared_ptr<JxlInputSource> JxlMakeInputSource(std::vector<uint8_t>&& bytes) {
+    auto owner = std::make_shared<const std::vector<uint8_t>>(std::move(bytes));
+    return std::make_shared<JxlInputSource>(owner->data(), owner->size(), owner);
+}
+
+std::shared_ptr<JxlInputSource> JxlMapInputSource(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    const size_t length = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // Mapping stays valid after the descriptor is closed
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return nullptr;
+    }
+    // Frames are read mostly front to back
+    madvise(mapped, length, MADV_SEQUENTIAL);
+    std::shared_ptr<const void> owner(mapped, [length](const void* address) {
+        munmap(const_cast<void*>(address), length);
+    });
+    return std::make_shared<JxlInputSource>(static_cast<const uint8_t*>(mapped), length, owner);
+}
+
+std::shared_ptr<JxlInputSource> JxlReadInputSource(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    std::vector<uint8_t> bytes(static_cast<size_t>(st.st_size));
+    size_t offset = 0;
+    while (offset < bytes.size()) {
+        const ssize_t count = pread(fd, bytes.data() + offset, bytes.size() - offset, static_cast<off_t>(offset));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        offset += static_cast<size_t>(count);
+    }
+    close(fd);
+    // File shrunk while it was read, what remains is handed to the decoder as a truncated image
+    if (offset == 0) {
+        return nullptr;
+    }
+    bytes.resize(offset);
+    return JxlMakeInputSource(std::move(bytes));
+}
@@ -0,0 +1,78 @@
+//
+//  JxlInputSource.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlInputSource_hpp
+#define JxlInputSource_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Immutable encoded bytes shared by decoders without copying. The source doesn't own the memory,
+ * the owner handle keeps it alive for as long as any decoder holds the source.
+ */
+class JxlInputSource {
+public:
+    JxlInputSource(const uint8_t* bytes, size_t length, std::shared_ptr<const void> owner):
+        bytes(bytes), length(length), owner(std::move(owner)) {
+    }
+
+    const uint8_t* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    const uint8_t* bytes;
+    size_t length;
+    std::shared_ptr<const void> owner;
+};
+
+// Takes ownership of the bytes
+std::shared_ptr<JxlInputSource> JxlMakeInputSource(std::vector<uint8_t>&& bytes);
+
+/**
+ * Maps the file read only, pages are loaded on access and can be dropped by the OS under pressure
+ * since they are backed by the file. Returns nullptr when the file cannot be mapped.
+ * The file must not be truncated or rewritten in place while any decoder holds the source, reading
+ * a page that is gone raises SIGBUS. Files that may change, e.g. downloads in progress or documents
+ * other apps can write, should be read with JxlReadInputSource instead.
+ */
+std::shared_ptr<JxlInputSource> JxlMapInputSource(const std::string& path);
+
+// Reads the whole file into memory, later changes to the file don't affect the source
+std::shared_ptr<JxlInputSource> JxlReadInputSource(const std::string& path);
+
+#endif
+
+#endif /* JxlInputSource_hpp */
@@ -31,18 +31,104 @@
 #import "CJpegXLAnimatedEncoder.h"
 #import "CJpegXLAnimatedDecoder.h"
 
+@interface JXLMetadataBox: NSObject
+/// Four characters box type, e.g. "Exif", "xml " or "jumb"
+@property (nonatomic, copy, nonnull) NSString *type;
+@property (nonatomic, copy, nonnull) NSData *data;
+/// Stored as Brotli compressed box
+@property (nonatomic) bool compressed;
+- (nonnull instancetype)initWithType:(nonnull NSString *)type data:(nonnull NSData *)data compressed:(bool)compressed;
+@end
+
+/// Parts of the codestream in the order of libjxl encoder statistics
+typedef NS_ENUM(NSInteger, JXLEncodeSection) {
+    kSectionHeader NS_SWIFT_NAME(header),
+    kSectionTOC NS_SWIFT_NAME(toc),
+    kSectionDictionary NS_SWIFT_NAME(dictionary),
+    kSectionSplines NS_SWIFT_NAME(splines),
+    kSectionNoise NS_SWIFT_NAME(noise),
+    kSectionQuant NS_SWIFT_NAME(quant),
+    kSectionModularTree NS_SWIFT_NAME(modularTree),
+    kSectionModularGlobal NS_SWIFT_NAME(modularGlobal),
+    kSectionDC NS_SWIFT_NAME(dc),
+    kSectionModularDCGroup NS_SWIFT_NAME(modularDCGroup),
+    kSectionControlFields NS_SWIFT_NAME(controlFields),
+    kSectionCoefficientOrder NS_SWIFT_NAME(coefficientOrder),
+    kSectionACHistogram NS_SWIFT_NAME(acHistogram),
+    kSectionAC NS_SWIFT_NAME(ac),
+    kSectionModularACGroup NS_SWIFT_NAME(modularACGroup)
+};
+
+/// Where the time of one encode went, in seconds of wall time unless noted
+@interface JXLEncodeStatistics: NSObject
+/// Basic info, color encoding, frame settings and channel analysis
+@property (nonatomic, readonly) NSTimeInterval setupTime;
+@property (nonatomic, readonly) NSTimeInterval addFrameTime;
+@property (nonatomic, readonly) NSTimeInterval processOutputTime;
+/// CPU time of the encoding thread and of the encoder tasks on its worker threads,
+/// other work of the process running meanwhile is not counted
+@property (nonatomic, readonly) NSTimeInterval cpuTime;
+/// CPU time over the wall time available to all threads, 0...1
+@property (nonatomic, readonly) double threadUtilization;
+@property (nonatomic, readonly) NSUInteger numThreads;
+@property (nonatomic, readonly) NSUInteger compressedBytes;
+/// Peak resident memory of the process after encoding
+@property (nonatomic, readonly) NSUInteger peakMemoryBytes;
+/// Compressed bytes spent on the section, rounded up from bits
+- (NSUInteger)bytesInSection:(JXLEncodeSection)section NS_SWIFT_NAME(bytes(in:));
+@end
+
+/// Memory and CPU an encode is expected to take, known before it is started
+@interface JXLResourceEstimate: NSObject
+@property (nonatomic, readonly) NSUInteger peakMemoryBytes;
+/// 1.0 is one megapixel RGB lossy image with effort 7
+@property (nonatomic, readonly) double relativeCost;
+/// CPU time summed over all threads, 0 until the estimator is calibrated
+@property (nonatomic, readonly) NSTimeInterval cpuTime;
+@end
+
 @interface JxlInternalCoder: NSObject
 - (nullable JXLSystemImage *)decode:(nonnull NSInputStream *)inputStream 
                              rescale:(CGSize)rescale
                              pixelFormat:(JXLPreferredPixelFormat)preferredPixelFormat
                              sampler:(JxlSampler)sampler
                              error:(NSError *_Nullable * _Nullable)error;
+- (nullable NSArray<JXLMetadataBox *> *)readMetadata:(nonnull NSData *)data error:(NSError *_Nullable * _Nullable)error;
 - (CGSize)getSize:(nonnull NSInputStream *)inputStream error:(NSError *_Nullable * _Nullable)error;
 - (nullable NSData *)encode:(nonnull JXLSystemImage *)platformImage
                      colorSpace:(JXLColorSpace)colorSpace
                      compressionOption:(JXLCompressionOption)compressionOption
                      effort:(int)effort
                      quality:(int)quality error:(NSError * _Nullable *_Nullable)error;
+- (nullable NSData *)encode:(nonnull JXLSystemImage *)platformImage
+                     colorSpace:(JXLColorSpace)colorSpace
+                     compressionOption:(JXLCompressionOption)compressionOption
+                     effort:(int)effort
+                     quality:(int)quality
+                     colorProfile:(JXLEncodingColorProfile)colorProfile
+                     progressive:(bool)progressive
+                     metadata:(nullable NSArray<JXLMetadataBox *> *)metadata
+                     passOffsets:(NSArray<NSNumber *> * _Nullable * _Nullable)passOffsets
+                     statistics:(JXLEncodeStatistics * _Nullable * _Nullable)statistics
+                     error:(NSError * _Nullable *_Nullable)error;
+- (nullable NSData *)encode:(nonnull JXLSystemImage *)platformImage
+                     colorSpace:(JXLColorSpace)colorSpace
+                     effort:(int)effort
+                     target:(JXLQualityTarget)target
+                     targetValue:(double)targetValue error:(NSError * _Nullable *_Nullable)error;
+- (nullable NSArray<NSData *> *)encodeBatch:(nonnull NSArray<JXLSystemImage *> *)platformImages
+                                 colorSpace:(JXLColorSpace)colorSpace
+                          compressionOption:(JXLCompressionOption)compressionOption
+                                     effort:(int)effort
+                                    quality:(int)quality error:(NSError * _Nullable *_Nullable)error;
+- (nonnull JXLResourceEstimate *)estimateResources:(CGSize)size
+                                        colorSpace:(JXLColorSpace)colorSpace
+                                 compressionOption:(JXLCompressionOption)compressionOption
+                                            effort:(int)effort;
+/// Refits the shared estimator by encoding synthetic images, no other encoding may run meanwhile
+- (BOOL)calibrateResourceEstimator:(nonnull NSArray<NSNumber *> *)efforts
+                              side:(NSInteger)side error:(NSError * _Nullable *_Nullable)error;
+- (bool)isResourceEstimatorCalibrated;
 @end
 
 #endif /* JXLCoder_h */
@@ -27,8 +27,14 @@
 #import "JxlInternalCoder.h"
 #import <vector>
 #import "JxlWorker.hpp"
+#import "JxlEncoderSession.hpp"
+#import "JxlBatchEncoder.hpp"
+#import "JxlTargetEncoder.hpp"
+#import "JxlMetadata.hpp"
+#import "JxlPixelAnalysis.hpp"
+#import "JxlResourceEstimator.hpp"
+#import <memory>
 #import <Accelerate/Accelerate.h>
-#import "RgbRgbaConverter.hpp"
 #import "RgbaScaler.h"
 #import <algorithm>
 
@@ -42,6 +48,31 @@ static void JXLCGData8ProviderReleaseDataCallback(void *info, const void *data,
     delete dataWrapper;
 }
 
+// Null when the system has no such color space
+static CGColorSpaceRef JXLCreateColorSpace(JxlEncodingColorSpace space) {
+    switch (space) {
+        case srgb:
+            return CGColorSpaceCreateDeviceRGB();
+        case linearSRGB:
+            return CGColorSpaceCreateWithName(kCGColorSpaceLinearSRGB);
+        case displayP3:
+            return CGColorSpaceCreateWithName(kCGColorSpaceDisplayP3);
+        case rec2020:
+            return CGColorSpaceCreateWithName(kCGColorSpaceITUR_2020);
+        case rec2100PQ:
+            if (@available(macOS 11.0, iOS 14.0, tvOS 14.0, watchOS 7.0, *)) {
+                return CGColorSpaceCreateWithName(kCGColorSpaceITUR_2100_PQ);
+            }
+            return nullptr;
+        case rec2100HLG:
+            if (@available(macOS 11.0, iOS 14.0, tvOS 14.0, watchOS 7.0, *)) {
+                return CGColorSpaceCreateWithName(kCGColorSpaceITUR_2100_HLG);
+            }
+            return nullptr;
+    }
+    return nullptr;
+}
+
 static inline float JXLGetDistance(const int quality)
 {
     if (quality == 0)
@@ -54,12 +85,132 @@ static inline float JXLGetDistance(const int quality)
     return distance;
 }
 
+static JxlEncoderSessionPool& JXLSharedEncoderSessionPool() {
+    static JxlEncoderSessionPool pool;
+    return pool;
+}
+
+@implementation JXLMetadataBox
+
+- (nonnull instancetype)initWithType:(nonnull NSString *)type data:(nonnull NSData *)data compressed:(bool)compressed {
+    self = [super init];
+    if (self) {
+        _type = [type copy];
+        _data = [data copy];
+        _compressed = compressed;
+    }
+    return self;
+}
+
+@end
+
+static_assert(kSectionModularACGroup == JXL_ENC_STAT_MODULAR_AC_GROUP_BITS, "Sections must follow libjxl statistics keys");
+
+@implementation JXLEncodeStatistics {
+    NSUInteger sectionBytes[kSectionModularACGroup + 1];
+}
+
+- (nonnull instancetype)initWithStatistics:(const JxlEncodeStatistics&)stats {
+    self = [super init];
+    if (self) {
+        _setupTime = stats.setup.wallMs / 1000.0;
+        _addFrameTime = stats.addFrame.wallMs / 1000.0;
+        _processOutputTime = stats.processOutput.wallMs / 1000.0;
+        _cpuTime = stats.totalCpuMs() / 1000.0;
+        _threadUtilization = stats.threadUtilization;
+        _numThreads = stats.numThreads;
+        _compressedBytes = stats.compressedBytes;
+        _peakMemoryBytes = stats.peakMemoryBytes;
+        for (NSInteger section = kSectionHeader; section <= kSectionModularACGroup; ++section) {
+            sectionBytes[section] = stats.sectionBytes(static_cast<JxlEncoderStatsKey>(section));
+        }
+    }
+    return self;
+}
+
+- (NSUInteger)bytesInSection:(JXLEncodeSection)section {
+    if (section < kSectionHeader || section > kSectionModularACGroup) {
+        return 0;
+    }
+    return sectionBytes[section];
+}
+
+@end
+
+@implementation JXLResourceEstimate
+
+- (nonnull instancetype)initWithEstimate:(const JxlResourceEstimate&)estimate {
+    self = [super init];
+    if (self) {
+        _peakMemoryBytes = estimate.peakMemoryBytes;
+        _relativeCost = estimate.relativeCost;
+        _cpuTime = estimate.cpuMs / 1000.0;
+    }
+    return self;
+}
+
+@end
+
 @implementation JxlInternalCoder
+
+-(bool)pixels:(nonnull JXLSystemImage *)platformImage colorSpace:(JxlPixelType)colorSpace
+          dst:(std::vector<uint8_t>&)pixels iccProfile:(std::vector<uint8_t>*)iccProfile
+        width:(int*)width height:(int*)height error:(NSError * _Nullable *_Nullable)error {
+    size_t bufferSize;
+    uint8_t* rgbaData;
+    if (iccProfile) {
+        // Keep pixels in their own color space, profile is passed through to encoder
+        NSData* icc = nil;
+        rgbaData = [platformImage jxlRGBAPixels:&bufferSize width:width height:height iccProfile:&icc premultiplied:false];
+        if (icc) {
+            iccProfile->assign((uint8_t*)icc.bytes, (uint8_t*)icc.bytes + icc.length);
+        }
+    } else {
+        rgbaData = [platformImage jxlRGBAPixels:&bufferSize width:width height:height];
+    }
+    if (*width < 0 || *height < 0) {
+        free(rgbaData);
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Width and height must be > 0!!" }];
+        return false;
+    }
+    if (!rgbaData) {
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Can' create preview of image" }];
+        return false;
+    }
+
+    if (colorSpace == rgb) {
+        // Alpha is dropped in the same pass that copies pixels out of the rendered buffer
+        JxlPixelTraits traits;
+        traits.opaque = true;
+        JxlCompactPixels(rgbaData, *width, *height, static_cast<size_t>(*width) * 4, 4, traits, pixels);
+    } else {
+        pixels.assign(rgbaData, rgbaData + bufferSize);
+    }
+    free(rgbaData);
+    return true;
+}
+
 - (nullable NSData *)encode:(nonnull JXLSystemImage *)platformImage
                     colorSpace:(JXLColorSpace)colorSpace
                     compressionOption:(JXLCompressionOption)compressionOption
                     effort:(int)effort
                     quality:(int)quality error:(NSError * _Nullable *_Nullable)error {
+    return [self encode:platformImage colorSpace:colorSpace compressionOption:compressionOption
+                 effort:effort quality:quality colorProfile:kColorProfileImage progressive:false metadata:nil
+            passOffsets:nil statistics:nil error:error];
+}
+
+- (nullable NSData *)encode:(nonnull JXLSystemImage *)platformImage
+                    colorSpace:(JXLColorSpace)colorSpace
+                    compressionOption:(JXLCompressionOption)compressionOption
+                    effort:(int)effort
+                    quality:(int)quality
+                    colorProfile:(JXLEncodingColorProfile)colorProfile
+                    progressive:(bool)progressive
+                    metadata:(nullable NSArray<JXLMetadataBox *> *)metadata
+                    passOffsets:(NSArray<NSNumber *> * _Nullable * _Nullable)passOffsets
+                    statistics:(JXLEncodeStatistics * _Nullable * _Nullable)statistics
+                    error:(NSError * _Nullable *_Nullable)error {
     try {
         if (quality < 0 || quality > 100) {
             *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Quality must be clamped in 0...100" }];
@@ -71,18 +222,6 @@ static inline float JXLGetDistance(const int quality)
             return nil;
         }
 
-        size_t bufferSize;
-        int width, height;
-        auto rgbaData = [platformImage jxlRGBAPixels:&bufferSize width:&width height:&height];
-        if (width < 0 || height < 0) {
-            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Width and height must be > 0!!" }];
-            return nil;
-        }
-        if (!rgbaData) {
-            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Can' create preview of image" }];
-            return nil;
-        }
-
         JxlPixelType jColorspace;
         JxlCompressionOption jCompressionOption;
 
@@ -103,28 +242,116 @@ static inline float JXLGetDistance(const int quality)
                 jCompressionOption = loosy;
                 break;
         }
-        std::vector<uint8_t> pixels;
-        pixels.insert(pixels.end(), (uint8_t*)rgbaData, rgbaData + bufferSize);
-        free(rgbaData);
 
-        if (jColorspace == rgb) {
-            auto resizedVector = [RgbRgbaConverter convertRGBAtoRGB:pixels width:width height:height];
-            if (resizedVector.size() == 1) {
-                *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Cannot convert RGBA pixels to RGB" }];
+        JxlEncodingParams params;
+        switch (colorProfile) {
+            case kColorProfileImage:
+            case kColorProfileSRGB:
+                params.colorProfile = srgb;
+                break;
+            case kColorProfileDisplayP3:
+                params.colorProfile = displayP3;
+                break;
+            case kColorProfileRec2020:
+                params.colorProfile = rec2020;
+                break;
+            case kColorProfileLinearSRGB:
+                params.colorProfile = linearSRGB;
+                break;
+            case kColorProfileRec2100PQ:
+                params.colorProfile = rec2100PQ;
+                break;
+            case kColorProfileRec2100HLG:
+                params.colorProfile = rec2100HLG;
+                break;
+        }
+
+        size_t bufferSize;
+        int width, height;
+        NSData* icc = nil;
+        // Rendered pixels are handed to encoder as is, alpha is skipped by encoder for RGB.
+        // Premultiplied bitmap is encoded natively, only RGB needs straight colors after alpha is dropped
+        const bool premultiplied = jColorspace == rgba;
+        std::unique_ptr<uint8_t, decltype(&free)> rgbaData(nullptr, free);
+        if (colorProfile == kColorProfileImage) {
+            rgbaData.reset([platformImage jxlRGBAPixels:&bufferSize width:&width height:&height
+                                             iccProfile:&icc premultiplied:premultiplied]);
+        } else {
+            CGColorSpaceRef targetColorSpace = JXLCreateColorSpace(params.colorProfile);
+            if (!targetColorSpace) {
+                *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Color profile is not supported on this system" }];
                 return nil;
             }
-            pixels = resizedVector;
+            rgbaData.reset([platformImage jxlRGBAPixels:&bufferSize width:&width height:&height
+                                           inColorSpace:targetColorSpace premultiplied:premultiplied]);
+            CGColorSpaceRelease(targetColorSpace);
+        }
+        if (!rgbaData) {
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Can' create preview of image" }];
+            return nil;
+        }
+        if (width < 0 || height < 0) {
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Width and height must be > 0!!" }];
+            return nil;
+        }
+        if (icc) {
+            params.iccProfile.assign((uint8_t*)icc.bytes, (uint8_t*)icc.bytes + icc.length);
+        }
+
+        JxlImageView view;
+        view.data = rgbaData.get();
+        view.width = width;
+        view.height = height;
+        view.stride = static_cast<size_t>(width) * 4;
+        view.components = 4;
+        view.skipAlpha = jColorspace == rgb;
+        view.premultiplied = premultiplied;
+
+        params.colorspace = jColorspace;
+        params.compressionOption = jCompressionOption;
+        params.distance = JXLGetDistance(quality);
+        params.effort = effort;
+        params.progressive = progressive;
+        for (JXLMetadataBox *box in metadata) {
+            JxlMetadataBox item;
+            item.type = std::string([box.type UTF8String]);
+            auto bytes = reinterpret_cast<const uint8_t*>(box.data.bytes);
+            item.contents.assign(bytes, bytes + box.data.length);
+            item.compress = box.compressed;
+            params.metadata.push_back(std::move(item));
         }
 
         JXLDataWrapper<uint8_t>* wrapper = new JXLDataWrapper<uint8_t>();
-        auto encoded = EncodeJxlOneshot(pixels, width, height, &wrapper->data, jColorspace, jCompressionOption, JXLGetDistance(quality), effort);
+        auto& pool = JXLSharedEncoderSessionPool();
+        auto session = pool.acquire();
+        JxlEncodeStatistics stats;
+        auto encoded = session->encode(view, params, &wrapper->data, statistics ? &stats : nullptr);
+        pool.release(std::move(session));
         if (!encoded) {
             delete wrapper;
             *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Cannot encode JXL image" }];
             return nil;
         }
 
-        pixels.resize(1);
+        rgbaData.reset();
+
+        if (passOffsets) {
+            std::vector<size_t> offsets;
+            if (!JxlFindProgressivePasses(wrapper->data.data(), wrapper->data.size(), &offsets)) {
+                delete wrapper;
+                *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Cannot find progressive passes of JXL image" }];
+                return nil;
+            }
+            NSMutableArray<NSNumber *> *result = [[NSMutableArray alloc] initWithCapacity:offsets.size()];
+            for (auto offset : offsets) {
+                [result addObject:@(offset)];
+            }
+            *passOffsets = result;
+        }
+
+        if (statistics) {
+            *statistics = [[JXLEncodeStatistics alloc] initWithStatistics:stats];
+        }
 
         auto data = [[NSData alloc] initWithBytesNoCopy:wrapper->data.data()
                                                  length:wrapper->data.size()
@@ -133,6 +360,11 @@ static inline float JXLGetDistance(const int quality)
         }];
 
         return data;
+    } catch (EncoderSessionError& err) {
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder"
+                                  code:500
+                                  userInfo:@{ NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Encoding image has failed with error: %s", err.what()] }];
+        return nullptr;
     } catch (std::bad_alloc &err) {
         *error = [[NSError alloc] initWithDomain:@"JXLCoder"
                                   code:500
@@ -141,6 +373,195 @@ static inline float JXLGetDistance(const int quality)
     }
 }
 
+- (nullable NSData *)encode:(nonnull JXLSystemImage *)platformImage
+                    colorSpace:(JXLColorSpace)colorSpace
+                    effort:(int)effort
+                    target:(JXLQualityTarget)target
+                    targetValue:(double)targetValue error:(NSError * _Nullable *_Nullable)error {
+    try {
+        if (effort < 1 || effort > 9) {
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Effort must be clamped in 1...9" }];
+            return nil;
+        }
+
+        if (targetValue <= 0) {
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Target value must be > 0" }];
+            return nil;
+        }
+
+        JxlPixelType jColorspace;
+        switch (colorSpace) {
+            case kRGB:
+                jColorspace = rgb;
+                break;
+            case kRGBA:
+                jColorspace = rgba;
+                break;
+        }
+
+        std::vector<uint8_t> pixels;
+        int width, height;
+        // Reference pixels for quality measurement must stay in sRGB as decoder returns them
+        if (![self pixels:platformImage colorSpace:jColorspace dst:pixels iccProfile:nullptr
+                    width:&width height:&height error:error]) {
+            return nil;
+        }
+
+        JxlEncodingParams params;
+        params.colorspace = jColorspace;
+        params.compressionOption = loosy;
+        params.effort = effort;
+
+        JxlQualitySearchParams search;
+        switch (target) {
+            case kTargetSSIM:
+                search.target = targetSSIM;
+                break;
+            case kTargetSize:
+                search.target = targetSize;
+                break;
+        }
+        search.value = targetValue;
+
+        JXLDataWrapper<uint8_t>* wrapper = new JXLDataWrapper<uint8_t>();
+        JxlQualitySearchResult result;
+        if (!EncodeJxlTargetQuality(pixels, width, height, params, search, &wrapper->data, &result)) {
+            delete wrapper;
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Cannot encode JXL image" }];
+            return nil;
+        }
+        if (!result.met) {
+            delete wrapper;
+            NSString *str = [NSString stringWithFormat:@"Quality target %.4g can't be met, closest result is %.4g at distance %.2f",
+                             targetValue, result.score, result.distance];
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: str }];
+            return nil;
+        }
+
+        auto data = [[NSData alloc] initWithBytesNoCopy:wrapper->data.data()
+                                                 length:wrapper->data.size()
+                                            deallocator:^(void * _Nonnull bytes, NSUInteger length) {
+            delete wrapper;
+        }];
+
+        return data;
+    } catch (EncoderSessionError& err) {
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder"
+                                  code:500
+                                  userInfo:@{ NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Encoding image has failed with error: %s", err.what()] }];
+        return nullptr;
+    } catch (std::bad_alloc &err) {
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder"
+                                  code:500
+                                  userInfo:@{ NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Encoding image memory error: %s", err.what()] }];
+        return nullptr;
+    }
+}
+
+- (nullable NSArray<NSData *> *)encodeBatch:(nonnull NSArray<JXLSystemImage *> *)platformImages
+                                 colorSpace:(JXLColorSpace)colorSpace
+                          compressionOption:(JXLCompressionOption)compressionOption
+                                     effort:(int)effort
+                                    quality:(int)quality error:(NSError * _Nullable *_Nullable)error {
+    try {
+        if (quality < 0 || quality > 100) {
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Quality must be clamped in 0...100" }];
+            return nil;
+        }
+
+        if (effort < 1 || effort > 9) {
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Effort must be clamped in 1...9" }];
+            return nil;
+        }
+
+        JxlPixelType jColorspace;
+        JxlCompressionOption jCompressionOption;
+
+        switch (colorSpace) {
+            case kRGB:
+                jColorspace = rgb;
+                break;
+            case kRGBA:
+                jColorspace = rgba;
+                break;
+        }
+
+        switch (compressionOption) {
+            case kLoseless:
+                jCompressionOption = loseless;
+                break;
+            case kLossy:
+                jCompressionOption = loosy;
+                break;
+        }
+
+        std::vector<JxlBatchEncodingItem> items(platformImages.count);
+        for (NSUInteger i = 0; i < platformImages.count; ++i) {
+            auto& item = items[i];
+            int width, height;
+            if (![self pixels:platformImages[i] colorSpace:jColorspace dst:item.pixels iccProfile:&item.params.iccProfile
+                        width:&width height:&height error:error]) {
+                return nil;
+            }
+            item.xsize = width;
+            item.ysize = height;
+            item.params.colorspace = jColorspace;
+            item.params.compressionOption = jCompressionOption;
+            item.params.distance = JXLGetDistance(quality);
+            item.params.effort = effort;
+        }
+
+        if (!EncodeJxlBatch(items, 0)) {
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Cannot encode JXL images" }];
+            return nil;
+        }
+
+        NSMutableArray<NSData *> *result = [[NSMutableArray alloc] initWithCapacity:items.size()];
+        for (auto& item : items) {
+            JXLDataWrapper<uint8_t>* wrapper = new JXLDataWrapper<uint8_t>();
+            wrapper->data = std::move(item.compressed);
+            item.pixels.clear();
+            auto data = [[NSData alloc] initWithBytesNoCopy:wrapper->data.data()
+                                                     length:wrapper->data.size()
+                                                deallocator:^(void * _Nonnull bytes, NSUInteger length) {
+                delete wrapper;
+            }];
+            [result addObject:data];
+        }
+        return result;
+    } catch (EncoderSessionError& err) {
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder"
+                                  code:500
+                                  userInfo:@{ NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Encoding image has failed with error: %s", err.what()] }];
+        return nullptr;
+    } catch (std::bad_alloc &err) {
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder"
+                                  code:500
+                                  userInfo:@{ NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Encoding image memory error: %s", err.what()] }];
+        return nullptr;
+    }
+}
+
+- (nullable NSArray<JXLMetadataBox *> *)readMetadata:(nonnull NSData *)data error:(NSError *_Nullable * _Nullable)error {
+    try {
+        std::vector<JxlMetadataBox> boxes;
+        if (!JxlReadMetadataBoxes(reinterpret_cast<const uint8_t*>(data.bytes), data.length, &boxes)) {
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Cannot read metadata of JXL image" }];
+            return nil;
+        }
+        NSMutableArray<JXLMetadataBox *> *result = [[NSMutableArray alloc] initWithCapacity:boxes.size()];
+        for (auto& box : boxes) {
+            NSString *type = [[NSString alloc] initWithBytes:box.type.data() length:box.type.size() encoding:NSASCIIStringEncoding];
+            NSData *contents = [[NSData alloc] initWithBytes:box.contents.data() length:box.contents.size()];
+            [result addObject:[[JXLMetadataBox alloc] initWithType:type ?: @"" data:contents compressed:box.compress]];
+        }
+        return result;
+    } catch (std::bad_alloc &err) {
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Allocating memory for metadata has failed with error: %s", err.what()] }];
+        return nil;
+    }
+}
+
 - (CGSize)getSize:(nonnull NSInputStream *)inputStream error:(NSError *_Nullable * _Nullable)error {
     try {
         int buffer_length = 30196;
@@ -244,6 +665,8 @@ static inline float JXLGetDistance(const int quality)
         std::vector<uint8_t> outputData;
         int components;
         JxlExposedOrientation jxlExposedOrientation = Identity;
+        bool alphaPremultiplied = false;
+        JxlEncodingColorSpace dataColorSpace = srgb;
         JxlDecodingPixelFormat pixelFormat;
         switch (preferredPixelFormat) {
             case kOptimal:
@@ -260,7 +683,7 @@ static inline float JXLGetDistance(const int quality)
                                            &outputData, &xSize, &ySize,
                                            &iccProfile, &depth, &components,
                                            &useFloats, &jxlExposedOrientation,
-                                           pixelFormat);
+                                           pixelFormat, &alphaPremultiplied, &dataColorSpace);
         if (!decoded) {
             *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Failed to decode JXL image" }];
             return nil;
@@ -326,7 +749,13 @@ static inline float JXLGetDistance(const int quality)
             colorSpace = CGColorSpaceCreateWithICCData(iccData);
             CFRelease(iccData);
         } else {
-            colorSpace = CGColorSpaceCreateDeviceRGB();
+            colorSpace = JXLCreateColorSpace(dataColorSpace);
+        }
+
+        // Pixels are always RGB, gray profile of gray image with unusual transfer can't describe them
+        if (colorSpace && CGColorSpaceGetNumberOfComponents(colorSpace) != 3) {
+            CGColorSpaceRelease(colorSpace);
+            colorSpace = nullptr;
         }
 
         if (!colorSpace) {
@@ -339,14 +768,14 @@ static inline float JXLGetDistance(const int quality)
         if (useFloats) {
             flags = (int)kCGBitmapByteOrder16Host | (int)kCGBitmapFloatComponents;
             if (components == 4) {
-                flags |= (int)kCGImageAlphaLast;
+                flags |= alphaPremultiplied ? (int)kCGImageAlphaPremultipliedLast : (int)kCGImageAlphaLast;
             } else {
                 flags |= (int)kCGImageAlphaNone;
             }
         } else {
             flags = (int)kCGImageByteOrderDefault;
             if (components == 4) {
-                flags |= (int)kCGImageAlphaLast;
+                flags |= alphaPremultiplied ? (int)kCGImageAlphaPremultipliedLast : (int)kCGImageAlphaLast;
             } else {
                 flags |= (int)kCGImageAlphaNone;
             }
@@ -395,4 +824,50 @@ static inline float JXLGetDistance(const int quality)
         return nullptr;
     }
 }
+- (nonnull JXLResourceEstimate *)estimateResources:(CGSize)size
+                                        colorSpace:(JXLColorSpace)colorSpace
+                                 compressionOption:(JXLCompressionOption)compressionOption
+                                            effort:(int)effort {
+    JxlResourceQuery query;
+    query.width = static_cast<uint32_t>(std::max(size.width, 0.0));
+    query.height = static_cast<uint32_t>(std::max(size.height, 0.0));
+    query.channels = colorSpace == kRGBA ? 4 : 3;
+    query.effort = effort;
+    query.compressionOption = compressionOption == kLoseless ? loseless : loosy;
+    JxlResourceEstimate estimate = JxlResourceEstimator::shared().estimate(query);
+    return [[JXLResourceEstimate alloc] initWithEstimate:estimate];
+}
+
+- (BOOL)calibrateResourceEstimator:(nonnull NSArray<NSNumber *> *)efforts
+                              side:(NSInteger)side error:(NSError * _Nullable *_Nullable)error {
+    if (side < 64 || side > 16384) {
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Side must be clamped in 64...16384" }];
+        return NO;
+    }
+    std::vector<int> jEfforts;
+    for (NSNumber* effort in efforts) {
+        if (effort.intValue < 1 || effort.intValue > 9) {
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Effort must be clamped in 1...9" }];
+            return NO;
+        }
+        jEfforts.push_back(effort.intValue);
+    }
+    try {
+        if (!JxlResourceEstimator::shared().calibrate(jEfforts, static_cast<uint32_t>(side))) {
+            *error = [[NSError alloc] initWithDomain:@"JXLCoder" code:500 userInfo:@{ NSLocalizedDescriptionKey: @"Cannot calibrate resource estimator" }];
+            return NO;
+        }
+        return YES;
+    } catch (std::bad_alloc &err) {
+        *error = [[NSError alloc] initWithDomain:@"JXLCoder"
+                                  code:500
+                                  userInfo:@{ NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Calibration memory error: %s", err.what()] }];
+        return NO;
+    }
+}
+
+- (bool)isResourceEstimatorCalibrated {
+    return JxlResourceEstimator::shared().isCalibrated();
+}
+
 @end
@@ -0,0 +1,131 @@
+//
+//  JxlMetadata.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlMetadata.hpp"
+#include <jxl/decode.h>
+#include <jxl/decode_cxx.h>
+#include <algorithm>
+
+static bool isCodestreamBox(const std::string& type) {
+    static const char* structural[] = { "JXL ", "ftyp", "jxlc", "jxlp", "jxll", "jxli", "jbrd" };
+    for (auto box : structural) {
+        if (type == box) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JxlReadMetadataBoxes(const uint8_t *jxl, size_t size, std::vector<JxlMetadataBox>* boxes) {
+    auto dec = JxlDecoderMake(nullptr);
+    if (JXL_DEC_SUCCESS != JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_BOX)) {
+        return false;
+    }
+
+    if (JXL_DEC_SUCCESS != JxlDecoderSetDecompressBoxes(dec.get(), JXL_TRUE)) {
+        return false;
+    }
+
+    JxlDecoderSetInput(dec.get(), jxl, size);
+    JxlDecoderCloseInput(dec.get());
+
+    boxes->clear();
+    JxlMetadataBox* current = nullptr;
+    const size_t chunkSize = 65536;
+
+    auto finishBox = [&]() {
+        if (current) {
+            size_t remaining = JxlDecoderReleaseBoxBuffer(dec.get());
+            current->contents.resize(current->contents.size() - remaining);
+            current = nullptr;
+        }
+    };
+
+    for (;;) {
+        JxlDecoderStatus status = JxlDecoderProcessInput(dec.get());
+
+        if (status == JXL_DEC_ERROR) {
+            return false;
+        } else if (status == JXL_DEC_NEED_MORE_INPUT) {
+            return false;
+        } else if (status == JXL_DEC_BOX) {
+            finishBox();
+            JxlBoxType type;
+            if (JXL_DEC_SUCCESS != JxlDecoderGetBoxType(dec.get(), type, JXL_TRUE)) {
+                return false;
+            }
+            std::string boxType(type, sizeof(JxlBoxType));
+            if (isCodestreamBox(boxType)) {
+                continue;
+            }
+            JxlBoxType rawType;
+            bool compressed = JXL_DEC_SUCCESS == JxlDecoderGetBoxType(dec.get(), rawType, JXL_FALSE)
+                && std::string(rawType, sizeof(JxlBoxType)) == "brob";
+            boxes->push_back({ boxType, std::vector<uint8_t>(chunkSize), compressed });
+            current = &boxes->back();
+            if (JXL_DEC_SUCCESS != JxlDecoderSetBoxBuffer(dec.get(), current->contents.data(), current->contents.size())) {
+                return false;
+            }
+        } else if (status == JXL_DEC_BOX_NEED_MORE_OUTPUT) {
+            if (!current) {
+                return false;
+            }
+            size_t remaining = JxlDecoderReleaseBoxBuffer(dec.get());
+            size_t used = current->contents.size() - remaining;
+            current->contents.resize(current->contents.size() * 2);
+            if (JXL_DEC_SUCCESS != JxlDecoderSetBoxBuffer(dec.get(), current->contents.data() + used,
+                                                         current->contents.size() - used)) {
+                return false;
+            }
+        } else if (status == JXL_DEC_SUCCESS) {
+            finishBox();
+            return true;
+        } else {
+            return false;
+        }
+    }
+}
+
+bool JxlAddMetadataBoxes(JxlEncoder* enc, const std::vector<JxlMetadataBox>& boxes) {
+    if (boxes.empty()) {
+        return true;
+    }
+    if (JXL_ENC_SUCCESS != JxlEncoderUseBoxes(enc)) {
+        return false;
+    }
+    for (auto& box : boxes) {
+        if (box.type.size() != sizeof(JxlBoxType)) {
+            return false;
+        }
+        JxlBoxType type;
+        std::copy(box.type.begin(), box.type.end(), type);
+        if (JXL_ENC_SUCCESS != JxlEncoderAddBox(enc, type, box.contents.data(), box.contents.size(),
+                                                box.compress ? JXL_TRUE : JXL_FALSE)) {
+            return false;
+        }
+    }
+    JxlEncoderCloseBoxes(enc);
+    return true;
+}
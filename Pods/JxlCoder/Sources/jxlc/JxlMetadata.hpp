@@ -0,0 +1,60 @@
+//
+//  JxlMetadata.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlMetadata_hpp
+#define JxlMetadata_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <jxl/encode.h>
+
+struct JxlMetadataBox {
+    // Four characters box type, e.g. "Exif", "xml " or "jumb"
+    std::string type;
+    // Exif contents start with 4 bytes big endian offset to the TIFF header, usually 0
+    std::vector<uint8_t> contents;
+    // Store as Brotli compressed "brob" box
+    bool compress = false;
+};
+
+/**
+ * Reads metadata boxes of the container, codestream is skipped without decoding pixels.
+ * Brotli compressed boxes are decompressed. Bare codestream has no boxes and returns empty list.
+ */
+bool JxlReadMetadataBoxes(const uint8_t *jxl, size_t size, std::vector<JxlMetadataBox>* boxes);
+
+/**
+ * Adds boxes to encoder and closes boxes input, must be called before frames are added
+ * so metadata comes before codestream.
+ */
+bool JxlAddMetadataBoxes(JxlEncoder* enc, const std::vector<JxlMetadataBox>& boxes);
+
+#endif
+
+#endif /* JxlMetadata_hpp */
@@ -0,0 +1,77 @@
+//
+//  JxlOutputSink.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+#include "JxlOutputSink.hpp"
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+JxlFileDescriptorSink::~JxlFileDescriptorSink() {
+    if (ownsDescriptor && fd >= 0) {
+        close(fd);
+    }
+}
+
+bool JxlFileDescriptorSink::write(const uint8_t* data, size_t size) {
+    if (fd < 0) {
+        return false;
+    }
+    // Sockets and pipes may accept only a part of the data
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+JxlFileSink::JxlFileSink(const std::string& path):
+JxlFileDescriptorSink(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644), true), path(path) {
+}
+
+JxlFileSink::~JxlFileSink() {
+    if (!finished) {
+        abort();
+    }
+}
+
+bool JxlFileSink::finish() {
+    finished = fd >= 0 && fsync(fd) == 0;
+    return finished;
+}
+
+void JxlFileSink::abort() {
+    finished = false;
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+        unlink(path.c_str());
+    }
+}
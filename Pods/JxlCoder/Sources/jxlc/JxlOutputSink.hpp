@@ -0,0 +1,108 @@
+//
+//  JxlOutputSink.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+#ifndef JxlOutputSink_hpp
+#define JxlOutputSink_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <string>
+#include <functional>
+
+/**
+ * Destination for encoded bytes written while frames are still being added.
+ * Writes come from whatever thread encodes the frame, one at a time.
+ */
+class JxlOutputSink {
+public:
+    virtual ~JxlOutputSink() {}
+
+    // Returns false when the data can't be written, encoding stops with an error
+    virtual bool write(const uint8_t* data, size_t size) = 0;
+
+    // Called once the last byte of the image was written
+    virtual bool finish() {
+        return true;
+    }
+
+    // Called instead of finish when the image can't be completed, what was written is not a valid image
+    virtual void abort() {}
+};
+
+class JxlCallbackSink : public JxlOutputSink {
+public:
+    JxlCallbackSink(std::function<bool(const uint8_t*, size_t)> callback): callback(callback) {}
+
+    bool write(const uint8_t* data, size_t size) override {
+        return callback(data, size);
+    }
+
+private:
+    std::function<bool(const uint8_t*, size_t)> callback;
+};
+
+/**
+ * Writes to a file descriptor, a file or a socket. For sockets SIGPIPE should be
+ * disabled by the caller (SO_NOSIGPIPE), a closed peer then fails the write instead.
+ * Bytes written before a failure stay where they went, the descriptor belongs to the caller.
+ */
+class JxlFileDescriptorSink : public JxlOutputSink {
+public:
+    JxlFileDescriptorSink(int fd, bool ownsDescriptor = false): fd(fd), ownsDescriptor(ownsDescriptor) {}
+    ~JxlFileDescriptorSink() override;
+
+    bool write(const uint8_t* data, size_t size) override;
+
+    bool isOpen() {
+        return fd >= 0;
+    }
+
+protected:
+    int fd;
+    bool ownsDescriptor;
+};
+
+/**
+ * Owns the file it creates: when encoding fails, or the sink goes away without being finished,
+ * the partial file is removed so no truncated image is left behind.
+ */
+class JxlFileSink : public JxlFileDescriptorSink {
+public:
+    // Creates or truncates the file, check isOpen() before use
+    JxlFileSink(const std::string& path);
+    ~JxlFileSink() override;
+
+    bool finish() override;
+    void abort() override;
+
+private:
+    std::string path;
+    bool finished = false;
+};
+
+#endif
+
+#endif /* JxlOutputSink_hpp */
@@ -0,0 +1,147 @@
+//
+//  JxlPixelAnalysis.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlPixelAnalysis.hpp"
+#include <algorithm>
+
+#if __arm64__
+#include <arm_neon.h>
+#endif
+
+static void AnalyzeRow(const uint8_t* src, size_t count, int components, JxlPixelTraits& traits) {
+    size_t x = 0;
+    bool opaque = traits.opaque;
+    bool grayscale = traits.grayscale;
+#if __arm64__
+    uint8x16_t alphaMin = vdupq_n_u8(255);
+    uint8x16_t grayMask = vdupq_n_u8(255);
+    if (components == 4) {
+        for (; x + 16 <= count; x += 16) {
+            uint8x16x4_t px = vld4q_u8(src + x * 4);
+            alphaMin = vminq_u8(alphaMin, px.val[3]);
+            grayMask = vandq_u8(grayMask, vandq_u8(vceqq_u8(px.val[0], px.val[1]),
+                                                   vceqq_u8(px.val[1], px.val[2])));
+        }
+    } else {
+        for (; x + 16 <= count; x += 16) {
+            uint8x16x3_t px = vld3q_u8(src + x * 3);
+            grayMask = vandq_u8(grayMask, vandq_u8(vceqq_u8(px.val[0], px.val[1]),
+                                                   vceqq_u8(px.val[1], px.val[2])));
+        }
+    }
+    opaque = opaque && vminvq_u8(alphaMin) == 255;
+    grayscale = grayscale && vminvq_u8(grayMask) == 255;
+#endif
+
+    for (; x < count; ++x) {
+        const uint8_t* px = src + x * components;
+        if (components == 4 && px[3] != 255) {
+            opaque = false;
+        }
+        if (px[0] != px[1] || px[1] != px[2]) {
+            grayscale = false;
+        }
+    }
+
+    traits.opaque = opaque;
+    traits.grayscale = grayscale;
+}
+
+static void CompactRow(const uint8_t* src, size_t count, int components,
+                       int colors, bool keepAlpha, uint8_t* out) {
+    const int newComponents = colors + (keepAlpha ? 1 : 0);
+    size_t x = 0;
+#if __arm64__
+    if (components == 4) {
+        for (; x + 16 <= count; x += 16) {
+            uint8x16x4_t px = vld4q_u8(src + x * 4);
+            if (newComponents == 1) {
+                vst1q_u8(out + x, px.val[0]);
+            } else if (newComponents == 2) {
+                uint8x16x2_t ga = { px.val[0], px.val[3] };
+                vst2q_u8(out + x * 2, ga);
+            } else if (newComponents == 3) {
+                uint8x16x3_t rgb = { px.val[0], px.val[1], px.val[2] };
+                vst3q_u8(out + x * 3, rgb);
+            } else {
+                vst4q_u8(out + x * 4, px);
+            }
+        }
+    } else {
+        for (; x + 16 <= count; x += 16) {
+            uint8x16x3_t px = vld3q_u8(src + x * 3);
+            if (newComponents == 1) {
+                vst1q_u8(out + x, px.val[0]);
+            } else {
+                vst3q_u8(out + x * 3, px);
+            }
+        }
+    }
+#endif
+
+    for (; x < count; ++x) {
+        const uint8_t* px = src + x * components;
+        uint8_t* dx = out + x * newComponents;
+        for (int c = 0; c < colors; ++c) {
+            dx[c] = px[c];
+        }
+        if (keepAlpha) {
+            dx[colors] = px[3];
+        }
+    }
+}
+
+JxlPixelTraits JxlAnalyzePixels(const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride,
+                                int components, bool detectGrayscale) {
+    JxlPixelTraits traits;
+    if (components != 3 && components != 4) {
+        return traits;
+    }
+    traits.opaque = components == 4;
+    traits.grayscale = detectGrayscale;
+
+    for (uint32_t y = 0; y < height && (traits.opaque || traits.grayscale); ++y) {
+        AnalyzeRow(pixels + y * stride, width, components, traits);
+    }
+    // RGB pixels have no alpha to drop
+    if (components == 3) {
+        traits.opaque = false;
+    }
+    return traits;
+}
+
+int JxlCompactPixels(const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride, int components,
+                     const JxlPixelTraits& traits, std::vector<uint8_t>& dst) {
+    const bool keepAlpha = components == 4 && !traits.opaque;
+    const int colors = traits.grayscale ? 1 : 3;
+    const int newComponents = colors + (keepAlpha ? 1 : 0);
+    const size_t rowSize = static_cast<size_t>(width) * newComponents;
+    dst.resize(rowSize * height);
+
+    for (uint32_t y = 0; y < height; ++y) {
+        CompactRow(pixels + y * stride, width, components, colors, keepAlpha, dst.data() + y * rowSize);
+    }
+    return newComponents;
+}
@@ -0,0 +1,58 @@
+//
+//  JxlPixelAnalysis.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlPixelAnalysis_hpp
+#define JxlPixelAnalysis_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+
+struct JxlPixelTraits {
+    // Every alpha value is 255
+    bool opaque = false;
+    // Every pixel has R == G == B
+    bool grayscale = false;
+};
+
+/**
+ * Scans interleaved 8-bit RGB or RGBA pixels for channels that may be dropped losslessly.
+ * Scan stops after the row where neither opaque alpha nor grayscale is possible anymore.
+ */
+JxlPixelTraits JxlAnalyzePixels(const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride,
+                                int components, bool detectGrayscale = true);
+
+/**
+ * Repacks pixels to tightly packed rows of the channels left after pruning, returns the new number of components.
+ * 1 - gray, 2 - gray + alpha, 3 - RGB, 4 - RGBA.
+ */
+int JxlCompactPixels(const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride, int components,
+                     const JxlPixelTraits& traits, std::vector<uint8_t>& dst);
+
+#endif
+
+#endif /* JxlPixelAnalysis_hpp */
@@ -0,0 +1,214 @@
+//
+//  JxlResourceEstimator.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlResourceEstimator.hpp"
+#include "JxlWorker.hpp"
+#include "JxlEncodeStatistics.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#if __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+// Samples of one megapixel RGB image, unit of relative cost
+static const double kCostUnitSamples = 3.0 * 1000000.0;
+
+// Rough figures of libjxl 0.9 on 8-bit images: XYB planes, AC coefficients and
+// quantization fields for VarDCT, integer channels and tree learning buffers for modular
+static const double kDefaultLossyBytes[10] = { 40, 40, 40, 44, 48, 52, 56, 60, 72, 80 };
+static const double kDefaultLosslessBytes[10] = { 12, 12, 16, 20, 24, 28, 32, 40, 56, 64 };
+static const double kDefaultLossyCost[10] = { 0.2, 0.2, 0.3, 0.5, 0.7, 0.9, 1.0, 1.3, 4.0, 12.0 };
+static const double kDefaultLosslessCost[10] = { 0.1, 0.1, 0.3, 0.6, 1.0, 1.4, 1.8, 2.5, 8.0, 30.0 };
+static const size_t kDefaultBaseMemory = 8 * 1024 * 1024;
+
+JxlResourceEstimator::JxlResourceEstimator(): baseMemory(kDefaultBaseMemory) {
+    for (int effort = 0; effort < 10; ++effort) {
+        bytesPerSample[0][effort] = kDefaultLossyBytes[effort];
+        bytesPerSample[1][effort] = kDefaultLosslessBytes[effort];
+        costPerSample[0][effort] = kDefaultLossyCost[effort] / kCostUnitSamples;
+        costPerSample[1][effort] = kDefaultLosslessCost[effort] / kCostUnitSamples;
+    }
+}
+
+JxlResourceEstimate JxlResourceEstimator::estimate(const JxlResourceQuery& query) {
+    std::lock_guard guard(lock);
+    const int mode = query.compressionOption == loseless ? 1 : 0;
+    const int effort = std::clamp(query.effort, 1, 9);
+    const double samples = static_cast<double>(query.width) * static_cast<double>(query.height)
+        * static_cast<double>(std::max(query.channels, 1));
+    // Input is copied once by libjxl in its own bit depth
+    const double inputBytes = samples * (query.bitDepth > 8 ? 2.0 : 1.0);
+
+    JxlResourceEstimate result;
+    result.peakMemoryBytes = baseMemory + static_cast<size_t>(samples * bytesPerSample[mode][effort] + inputBytes);
+    result.relativeCost = samples * costPerSample[mode][effort];
+    result.cpuMs = result.relativeCost * cpuMsPerCost;
+    return result;
+}
+
+bool JxlResourceEstimator::isCalibrated() {
+    std::lock_guard guard(lock);
+    return cpuMsPerCost > 0;
+}
+
+JxlResourceEstimator& JxlResourceEstimator::shared() {
+    static JxlResourceEstimator estimator;
+    return estimator;
+}
+
+static size_t JxlHeapInUse() {
+#if __APPLE__
+    malloc_statistics_t stats;
+    malloc_zone_statistics(nullptr, &stats);
+    return stats.size_in_use;
+#elif defined(__GLIBC__)
+    // __GLIBC_PREREQ exists only with glibc, it can't share the condition above
+#if __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+#else
+    return 0;
+#endif
+}
+
+struct JxlMeasurement {
+    size_t peakBytes = 0;
+    double cpuMs = 0;
+};
+
+static std::vector<uint8_t> JxlSyntheticImage(uint32_t side) {
+    // Gradients with noise, so neither mode compresses it trivially
+    std::vector<uint8_t> pixels(static_cast<size_t>(side) * side * 3);
+    uint32_t seed = 0x9E3779B9u;
+    for (uint32_t y = 0; y < side; ++y) {
+        for (uint32_t x = 0; x < side; ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            uint8_t noise = static_cast<uint8_t>(seed >> 27);
+            uint8_t* px = &pixels[(static_cast<size_t>(y) * side + x) * 3];
+            px[0] = static_cast<uint8_t>(x * 255 / side) ^ noise;
+            px[1] = static_cast<uint8_t>(y * 255 / side) + noise;
+            px[2] = static_cast<uint8_t>((x + y) * 127 / side) - noise;
+        }
+    }
+    return pixels;
+}
+
+static bool JxlMeasureEncode(const std::vector<uint8_t>& pixels, uint32_t side, int effort,
+                             JxlCompressionOption compressionOption, JxlMeasurement* measurement) {
+    const size_t baseline = JxlHeapInUse();
+    std::atomic<bool> running(true);
+    std::atomic<size_t> peak(baseline);
+    std::thread sampler([&]() {
+        while (running.load()) {
+            size_t current = JxlHeapInUse();
+            if (current > peak.load()) {
+                peak.store(current);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    });
+
+    std::vector<uint8_t> compressed;
+    JxlEncodeStatistics stats;
+    bool encoded = EncodeJxlOneshot(pixels, side, side, &compressed, rgb, compressionOption,
+                                    compressionOption == loseless ? 0.0f : 1.0f, effort, &stats);
+    running.store(false);
+    sampler.join();
+
+    if (!encoded) {
+        return false;
+    }
+    measurement->peakBytes = peak.load() > baseline ? peak.load() - baseline : 0;
+    measurement->cpuMs = stats.totalCpuMs();
+    return true;
+}
+
+bool JxlResourceEstimator::calibrate(const std::vector<int>& efforts, uint32_t side) {
+    if (side < 64 || JxlHeapInUse() == 0) {
+        return false;
+    }
+    const uint32_t smallSide = side / 2;
+    auto large = JxlSyntheticImage(side);
+    auto small = JxlSyntheticImage(smallSide);
+    const double largeSamples = static_cast<double>(side) * side * 3;
+    const double smallSamples = static_cast<double>(smallSide) * smallSide * 3;
+
+    double newBytes[2][10];
+    double newCost[2][10];
+    bool measured[2][10] = {};
+    double bases = 0;
+    int basesCount = 0;
+
+    for (int mode = 0; mode < 2; ++mode) {
+        auto compressionOption = mode == 1 ? loseless : loosy;
+        for (int effort : efforts) {
+            if (effort < 1 || effort > 9) {
+                continue;
+            }
+            JxlMeasurement smallRun, largeRun;
+            if (!JxlMeasureEncode(small, smallSide, effort, compressionOption, &smallRun)
+                || !JxlMeasureEncode(large, side, effort, compressionOption, &largeRun)) {
+                return false;
+            }
+            double slope = (static_cast<double>(largeRun.peakBytes) - static_cast<double>(smallRun.peakBytes))
+                / (largeSamples - smallSamples);
+            // Input copy is accounted separately in estimate
+            newBytes[mode][effort] = std::max(slope - 1.0, 1.0);
+            newCost[mode][effort] = largeRun.cpuMs / largeSamples;
+            measured[mode][effort] = true;
+            bases += static_cast<double>(largeRun.peakBytes) - slope * largeSamples;
+            basesCount += 1;
+        }
+    }
+
+    // Relative cost stays in units of lossy effort 7, CPU time of the unit is measured directly
+    JxlMeasurement unit;
+    if (!JxlMeasureEncode(large, side, 7, loosy, &unit) || unit.cpuMs <= 0) {
+        return false;
+    }
+    const double msPerCost = unit.cpuMs / largeSamples * kCostUnitSamples;
+
+    std::lock_guard guard(lock);
+    for (int mode = 0; mode < 2; ++mode) {
+        for (int effort = 1; effort < 10; ++effort) {
+            if (measured[mode][effort]) {
+                bytesPerSample[mode][effort] = newBytes[mode][effort];
+                costPerSample[mode][effort] = newCost[mode][effort] / msPerCost;
+            }
+        }
+    }
+    if (basesCount > 0) {
+        baseMemory = static_cast<size_t>(std::max(bases / basesCount, 0.0));
+    }
+    cpuMsPerCost = msPerCost;
+    return true;
+}
@@ -0,0 +1,91 @@
+//
+//  JxlResourceEstimator.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlResourceEstimator_hpp
+#define JxlResourceEstimator_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include "JxlDefinitions.h"
+
+struct JxlResourceQuery {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    int channels = 4;
+    int bitDepth = 8;
+    int effort = 7;
+    JxlCompressionOption compressionOption = loosy;
+};
+
+struct JxlResourceEstimate {
+    size_t peakMemoryBytes = 0;
+    // 1.0 is one megapixel RGB lossy image with effort 7
+    double relativeCost = 0;
+    // CPU time summed over all threads, available only after calibration
+    double cpuMs = 0;
+};
+
+/**
+ * Predicts memory and CPU needed by an encoding before it's started,
+ * so jobs may be admitted or packed onto workers without running out of memory.
+ * Built-in coefficients are conservative, calibrate refits them against real encodings on this device.
+ */
+class JxlResourceEstimator {
+public:
+    JxlResourceEstimator();
+
+    JxlResourceEstimate estimate(const JxlResourceQuery& query);
+
+    /**
+     * Encodes synthetic images with EncodeJxlOneshot and refits coefficients of the provided efforts.
+     * Each effort is measured on two sizes to separate fixed overhead from per pixel memory.
+     * Takes from a fraction of second to minutes for efforts 8 and 9, must not run concurrently with other encodings
+     * because heap usage of the whole process is sampled.
+     *
+     * @param efforts efforts to measure, others keep their previous coefficients
+     * @param side side of the larger synthetic square image
+     */
+    bool calibrate(const std::vector<int>& efforts = { 1, 3, 5, 7 }, uint32_t side = 1024);
+
+    bool isCalibrated();
+
+    static JxlResourceEstimator& shared();
+
+private:
+    // Indexed by [lossless][effort]
+    double bytesPerSample[2][10];
+    double costPerSample[2][10];
+    size_t baseMemory;
+    double cpuMsPerCost = 0;
+    std::mutex lock;
+};
+
+#endif
+
+#endif /* JxlResourceEstimator_hpp */
@@ -0,0 +1,247 @@
+//
+//  JxlTargetEncoder.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlTargetEncoder.hpp"
+#include "JxlEncoderSession.hpp"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+static inline float JxlSRGBToLinear(float v) {
+    return v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+}
+
+std::vector<float> JxlLumaPlane(const uint8_t* pixels, uint32_t xsize, uint32_t ysize, int components) {
+    float lut[256];
+    for (int i = 0; i < 256; ++i) {
+        lut[i] = JxlSRGBToLinear(static_cast<float>(i) / 255.0f);
+    }
+    std::vector<float> plane(static_cast<size_t>(xsize) * ysize);
+    const size_t count = plane.size();
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* px = pixels + i * components;
+        plane[i] = 0.2126f * lut[px[0]] + 0.7152f * lut[px[1]] + 0.0722f * lut[px[2]];
+    }
+    return plane;
+}
+
+double JxlComputeSSIM(const std::vector<float>& reference, const uint8_t* distorted,
+                      uint32_t xsize, uint32_t ysize, int components) {
+    std::vector<float> other = JxlLumaPlane(distorted, xsize, ysize, components);
+    const int window = 8;
+    const int step = 4;
+    const double c1 = 0.01 * 0.01;
+    const double c2 = 0.03 * 0.03;
+    if (xsize < window || ysize < window) {
+        double sum = 0;
+        for (size_t i = 0; i < other.size(); ++i) {
+            sum += std::abs(reference[i] - other[i]);
+        }
+        return other.empty() ? 1.0 : 1.0 - sum / other.size();
+    }
+
+    double total = 0;
+    size_t windows = 0;
+    for (uint32_t y = 0; y + window <= ysize; y += step) {
+        for (uint32_t x = 0; x + window <= xsize; x += step) {
+            double sumA = 0, sumB = 0, sumAA = 0, sumBB = 0, sumAB = 0;
+            for (int j = 0; j < window; ++j) {
+                const float* rowA = reference.data() + (y + j) * static_cast<size_t>(xsize) + x;
+                const float* rowB = other.data() + (y + j) * static_cast<size_t>(xsize) + x;
+                for (int i = 0; i < window; ++i) {
+                    double a = rowA[i];
+                    double b = rowB[i];
+                    sumA += a;
+                    sumB += b;
+                    sumAA += a * a;
+                    sumBB += b * b;
+                    sumAB += a * b;
+                }
+            }
+            const double n = window * window;
+            double muA = sumA / n;
+            double muB = sumB / n;
+            double varA = sumAA / n - muA * muA;
+            double varB = sumBB / n - muB * muB;
+            double covAB = sumAB / n - muA * muB;
+            total += ((2 * muA * muB + c1) * (2 * covAB + c2)) /
+                     ((muA * muA + muB * muB + c1) * (varA + varB + c2));
+            windows += 1;
+        }
+    }
+    return total / static_cast<double>(windows);
+}
+
+struct JxlQualityCandidate {
+    float distance;
+    bool encoded = false;
+    bool passed = false;
+    double score = 0;
+    std::vector<uint8_t> compressed;
+};
+
+static void JxlEvaluateCandidate(JxlEncoderSessionPool& pool,
+                                 const std::vector<uint8_t> &pixels, const uint32_t xsize, const uint32_t ysize,
+                                 const JxlEncodingParams& params, const JxlQualitySearchParams& search,
+                                 const std::vector<float>& reference, JxlQualityCandidate& candidate) {
+    try {
+        JxlEncodingParams trial = params;
+        trial.distance = candidate.distance;
+        auto session = pool.acquire();
+        candidate.encoded = session->encode(pixels, xsize, ysize, trial, &candidate.compressed);
+        pool.release(std::move(session));
+        if (!candidate.encoded) {
+            return;
+        }
+        if (search.target == targetSize) {
+            candidate.score = static_cast<double>(candidate.compressed.size());
+            candidate.passed = candidate.score <= search.value;
+            return;
+        }
+
+        std::vector<uint8_t> decoded, iccProfile;
+        size_t dx, dy;
+        int depth, components;
+        bool useFloats;
+        JxlExposedOrientation orientation;
+        if (!DecodeJpegXlOneShot(candidate.compressed.data(), candidate.compressed.size(),
+                                 &decoded, &dx, &dy, &iccProfile, &depth, &components,
+                                 &useFloats, &orientation, r8)
+            || dx != xsize || dy != ysize) {
+            candidate.encoded = false;
+            return;
+        }
+        candidate.score = JxlComputeSSIM(reference, decoded.data(), xsize, ysize, components);
+        candidate.passed = candidate.score >= search.value;
+    } catch (std::exception& err) {
+        candidate.encoded = false;
+    }
+}
+
+bool EncodeJxlTargetQuality(const std::vector<uint8_t> &pixels, const uint32_t xsize,
+                            const uint32_t ysize, const JxlEncodingParams& params,
+                            const JxlQualitySearchParams& search,
+                            std::vector<uint8_t> *compressed, JxlQualitySearchResult* result) {
+    if (params.compressionOption == loseless) {
+        JxlEncoderSession session;
+        if (!session.encode(pixels, xsize, ysize, params, compressed)) {
+            return false;
+        }
+        // Lossless output is exact, so only the size target can be missed
+        if (result) {
+            result->distance = 0;
+            result->score = search.target == targetSize ? static_cast<double>(compressed->size()) : 1.0;
+            result->met = search.target == targetSSIM || result->score <= search.value;
+        }
+        return true;
+    }
+
+    const int components = params.colorspace == rgba ? 4 : 3;
+    std::vector<float> reference;
+    if (search.target == targetSSIM) {
+        reference = JxlLumaPlane(pixels.data(), xsize, ysize, components);
+    }
+
+    const size_t candidatesCount = std::max(search.candidatesPerRound, static_cast<size_t>(1));
+    const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+    const size_t threadsPerCandidate = cores / candidatesCount;
+    JxlEncoderSessionPool pool(candidatesCount, threadsPerCandidate <= 1 ? 0 : threadsPerCandidate);
+
+    // SSIM decreases with distance so passing candidates are on the left,
+    // size decreases with distance so passing candidates are on the right
+    const bool passesOnLeft = search.target == targetSSIM;
+    float lo = search.minDistance;
+    float hi = search.maxDistance;
+    bool found = false;
+    JxlQualityCandidate best;
+
+    for (int round = 0; round < search.maxRounds; ++round) {
+        std::vector<JxlQualityCandidate> candidates(candidatesCount);
+        for (size_t i = 0; i < candidatesCount; ++i) {
+            candidates[i].distance = lo + (hi - lo) * static_cast<float>(i + 1) / static_cast<float>(candidatesCount + 1);
+        }
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < candidatesCount; ++i) {
+            workers.emplace_back([&, i]() {
+                JxlEvaluateCandidate(pool, pixels, xsize, ysize, params, search, reference, candidates[i]);
+            });
+        }
+        JxlEvaluateCandidate(pool, pixels, xsize, ysize, params, search, reference, candidates[0]);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        float newLo = lo, newHi = hi;
+        if (passesOnLeft) {
+            for (auto& candidate : candidates) {
+                if (!candidate.encoded) {
+                    continue;
+                }
+                if (candidate.passed) {
+                    newLo = candidate.distance;
+                    best = std::move(candidate);
+                    found = true;
+                } else {
+                    newHi = candidate.distance;
+                    break;
+                }
+            }
+        } else {
+            for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+                if (!it->encoded) {
+                    continue;
+                }
+                if (it->passed) {
+                    newHi = it->distance;
+                    best = std::move(*it);
+                    found = true;
+                } else {
+                    newLo = it->distance;
+                    break;
+                }
+            }
+        }
+        lo = newLo;
+        hi = newHi;
+    }
+
+    if (!found) {
+        // Nothing met the target, so falling back to the best effort bound
+        best.distance = passesOnLeft ? search.minDistance : search.maxDistance;
+        JxlEvaluateCandidate(pool, pixels, xsize, ysize, params, search, reference, best);
+        if (!best.encoded) {
+            return false;
+        }
+    }
+
+    *compressed = std::move(best.compressed);
+    if (result) {
+        result->distance = best.distance;
+        result->score = best.score;
+        result->met = found;
+    }
+    return true;
+}
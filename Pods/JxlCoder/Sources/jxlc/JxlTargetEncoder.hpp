@@ -0,0 +1,91 @@
+//
+//  JxlTargetEncoder.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlTargetEncoder_hpp
+#define JxlTargetEncoder_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <vector>
+#include "JxlDefinitions.h"
+#include "JxlWorker.hpp"
+
+enum JxlQualityTarget {
+    // Structural similarity of the luma, 0...1
+    targetSSIM = 1,
+    // Maximum size of the compressed file in bytes
+    targetSize = 2
+};
+
+struct JxlQualitySearchParams {
+    JxlQualityTarget target = targetSSIM;
+    double value = 0.95;
+    float minDistance = 0.1f;
+    float maxDistance = 15.0f;
+    // Each round shrinks the search interval by candidatesPerRound + 1 times
+    int maxRounds = 3;
+    size_t candidatesPerRound = 3;
+};
+
+struct JxlQualitySearchResult {
+    float distance = 0;
+    // SSIM or size in bytes of the returned image, depending on the target
+    double score = 0;
+    // False when no distance in the range met the target and the closest bound was encoded instead
+    bool met = false;
+};
+
+/**
+ * Computes SSIM between luma of two 8-bit images with the same dimensions.
+ * @param components number of interleaved channels in each image, 3 or 4
+ */
+double JxlComputeSSIM(const std::vector<float>& reference, const uint8_t* distorted,
+                      uint32_t xsize, uint32_t ysize, int components);
+
+/**
+ * Converts 8-bit interleaved pixels to the linear plane of luma
+ */
+std::vector<float> JxlLumaPlane(const uint8_t* pixels, uint32_t xsize, uint32_t ysize, int components);
+
+/**
+ * Searches the distance that meets the target with as few bytes as possible.
+ * Candidates of each round are encoded concurrently, input pixels and reference luma are shared between trials.
+ *
+ * Returns false only when nothing could be encoded, check result.met to know if the target was reached.
+ *
+ * @param params base encoding params, distance is ignored
+ * @param compressed will be populated with the best found candidate, or with the closest bound when
+ * the target can't be met
+ * @param result distance and score of the returned image, may be null
+ */
+bool EncodeJxlTargetQuality(const std::vector<uint8_t> &pixels, const uint32_t xsize,
+                            const uint32_t ysize, const JxlEncodingParams& params,
+                            const JxlQualitySearchParams& search,
+                            std::vector<uint8_t> *compressed, JxlQualitySearchResult* result);
+
+#endif
+
+#endif /* JxlTargetEncoder_hpp */
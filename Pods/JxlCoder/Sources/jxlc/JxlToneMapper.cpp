@@ -0,0 +1,162 @@
+//
+//  JxlToneMapper.cpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "JxlToneMapper.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const int lutSize = 4096;
+// BT.2408 reference white
+static const float sdrWhite = 203.0f;
+
+static float PQToNits(float v) {
+    const float m1 = 2610.0f / 16384.0f;
+    const float m2 = 2523.0f / 4096.0f * 128.0f;
+    const float c1 = 3424.0f / 4096.0f;
+    const float c2 = 2413.0f / 4096.0f * 32.0f;
+    const float c3 = 2392.0f / 4096.0f * 32.0f;
+    const float p = std::pow(std::max(v, 0.0f), 1.0f / m2);
+    return 10000.0f * std::pow(std::max(p - c1, 0.0f) / (c2 - c3 * p), 1.0f / m1);
+}
+
+static float HLGToScene(float v) {
+    const float a = 0.17883277f;
+    const float b = 0.28466892f;
+    const float c = 0.55991073f;
+    v = std::max(v, 0.0f);
+    if (v <= 0.5f) {
+        return v * v / 3.0f;
+    }
+    return (std::exp((v - c) / a) + b) / 12.0f;
+}
+
+static float SrgbEncode(float v) {
+    if (v <= 0.0031308f) {
+        return 12.92f * v;
+    }
+    return 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+}
+
+JxlToneMapper::JxlToneMapper(const JxlColorEncoding& encoding, float intensityTarget) {
+    switch (encoding.transfer_function) {
+        case JXL_TRANSFER_FUNCTION_PQ:
+            transfer = transferPQ;
+            break;
+        case JXL_TRANSFER_FUNCTION_HLG:
+            transfer = transferHLG;
+            break;
+        case JXL_TRANSFER_FUNCTION_LINEAR:
+            transfer = transferLinear;
+            break;
+        default:
+            transfer = transferNone;
+            break;
+    }
+
+    if (encoding.primaries == JXL_PRIMARIES_2100) {
+        lumaR = 0.2627f;
+        lumaG = 0.6780f;
+        lumaB = 0.0593f;
+    } else if (encoding.primaries == JXL_PRIMARIES_P3) {
+        lumaR = 0.2290f;
+        lumaG = 0.6917f;
+        lumaB = 0.0793f;
+    } else {
+        lumaR = 0.2126f;
+        lumaG = 0.7152f;
+        lumaB = 0.0722f;
+    }
+
+    const float peak = intensityTarget > 0 ? intensityTarget : (transfer == transferPQ ? 10000.0f : 1000.0f);
+    const float white = std::max(peak / sdrWhite, 1.0f);
+    whiteSquared = white * white;
+    linearScale = peak / sdrWhite;
+    hlgPeak = peak / sdrWhite;
+    // BT.2100 system gamma extended to the nominal peak
+    hlgGamma = 1.2f + 0.42f * std::log10(peak / 1000.0f);
+
+    if (transfer == transferPQ || transfer == transferHLG) {
+        toLinear.resize(lutSize + 1);
+        for (int i = 0; i <= lutSize; ++i) {
+            const float v = static_cast<float>(i) / lutSize;
+            toLinear[i] = transfer == transferPQ ? PQToNits(v) / sdrWhite : HLGToScene(v);
+        }
+    }
+
+    toSrgb.resize(lutSize + 1);
+    for (int i = 0; i <= lutSize; ++i) {
+        const float v = transfer == transferNone ? static_cast<float>(i) / lutSize
+                                                 : SrgbEncode(static_cast<float>(i) / lutSize);
+        toSrgb[i] = static_cast<uint8_t>(std::lround(std::min(std::max(v, 0.0f), 1.0f) * 255.0f));
+    }
+}
+
+float JxlToneMapper::linearize(float v) const {
+    if (transfer == transferLinear) {
+        return std::max(v, 0.0f) * linearScale;
+    }
+    const float position = std::min(std::max(v, 0.0f), 1.0f) * lutSize;
+    const int index = std::min(static_cast<int>(position), lutSize - 1);
+    const float fraction = position - static_cast<float>(index);
+    return toLinear[index] + (toLinear[index + 1] - toLinear[index]) * fraction;
+}
+
+static inline uint8_t LookupSrgb(const std::vector<uint8_t>& lut, float v) {
+    return lut[static_cast<int>(std::min(std::max(v, 0.0f), 1.0f) * lutSize + 0.5f)];
+}
+
+void JxlToneMapper::mapRow(const float* src, uint8_t* dst, size_t pixels) const {
+    for (size_t x = 0; x < pixels; ++x, src += 4, dst += 4) {
+        if (transfer == transferNone) {
+            dst[0] = LookupSrgb(toSrgb, src[0]);
+            dst[1] = LookupSrgb(toSrgb, src[1]);
+            dst[2] = LookupSrgb(toSrgb, src[2]);
+        } else {
+            float r = linearize(src[0]);
+            float g = linearize(src[1]);
+            float b = linearize(src[2]);
+            float luma = lumaR * r + lumaG * g + lumaB * b;
+            if (transfer == transferHLG) {
+                // OOTF, scene light to display light relative to SDR white
+                const float ootf = luma > 0 ? hlgPeak * std::pow(luma, hlgGamma - 1.0f) : 0.0f;
+                r *= ootf;
+                g *= ootf;
+                b *= ootf;
+                luma *= ootf;
+            }
+            if (luma > 0) {
+                const float mapped = luma * (1.0f + luma / whiteSquared) / (1.0f + luma);
+                const float scale = mapped / luma;
+                r *= scale;
+                g *= scale;
+                b *= scale;
+            }
+            dst[0] = LookupSrgb(toSrgb, r);
+            dst[1] = LookupSrgb(toSrgb, g);
+            dst[2] = LookupSrgb(toSrgb, b);
+        }
+        dst[3] = static_cast<uint8_t>(std::lround(std::min(std::max(src[3], 0.0f), 1.0f) * 255.0f));
+    }
+}
@@ -0,0 +1,82 @@
+//
+//  JxlToneMapper.hpp
+//  JxclCoder [https://github.com/awxkee/jxl-coder-swift]
+//
+//  Created by Radzivon Bartoshyk on 19/10/2026.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef JxlToneMapper_hpp
+#define JxlToneMapper_hpp
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include <jxl/color_encoding.h>
+
+/**
+ * Fused conversion of float RGBA rows decoded from an HDR image into 8-bit SDR.
+ * PQ, HLG and linear content is brought to display light, luminance is compressed
+ * by the extended Reinhard curve with the peak of the image mapped to SDR white,
+ * and the result is encoded with the sRGB transfer keeping the original primaries.
+ * Other transfer functions are SDR already and are only quantized.
+ */
+class JxlToneMapper {
+public:
+    // Encoding is the color encoding of the decoded pixels, intensity target is the peak in nits
+    JxlToneMapper(const JxlColorEncoding& encoding, float intensityTarget);
+
+    void mapRow(const float* src, uint8_t* dst, size_t pixels) const;
+
+    // False when the content is SDR and rows are only quantized
+    bool isToneMapping() const {
+        return transfer != transferNone;
+    }
+
+private:
+    enum Transfer {
+        transferNone = 1,
+        transferPQ = 2,
+        transferHLG = 3,
+        transferLinear = 4
+    };
+
+    float linearize(float v) const;
+
+    Transfer transfer;
+    // Encoded value to display light relative to SDR white, sampled at lutSize + 1 points
+    std::vector<float> toLinear;
+    // Linear [0, 1] to 8-bit sRGB encoded value
+    std::vector<uint8_t> toSrgb;
+    float lumaR;
+    float lumaG;
+    float lumaB;
+    // Squared peak relative to SDR white
+    float whiteSquared;
+    float linearScale;
+    float hlgPeak;
+    float hlgGamma;
+};
+
+#endif
+
+#endif /* JxlToneMapper_hpp */
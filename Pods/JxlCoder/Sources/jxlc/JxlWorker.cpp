@@ -24,6 +24,7 @@
 //
 
 #include "JxlWorker.hpp"
+#include "JxlPixelAnalysis.hpp"
 #include <jxl/decode.h>
 #include <jxl/decode_cxx.h>
 #include <jxl/resizable_parallel_runner.h>
@@ -32,6 +33,9 @@
 #include <jxl/encode_cxx.h>
 #include <jxl/thread_parallel_runner_cxx.h>
 #include <vector>
+#include <algorithm>
+#include <optional>
+#include <memory>
 
 bool DecodeJpegXlOneShot(const uint8_t *jxl, size_t size,
                          std::vector<uint8_t> *pixels, size_t *xsize,
@@ -41,7 +45,12 @@ bool DecodeJpegXlOneShot(const uint8_t *jxl, size_t size,
                          int* components,
                          bool* useFloats,
                          JxlExposedOrientation* exposedOrientation,
-                         JxlDecodingPixelFormat pixelFormat) {
+                         JxlDecodingPixelFormat pixelFormat,
+                         bool* alphaPremultiplied,
+                         JxlEncodingColorSpace* colorSpace) {
+    if (colorSpace) {
+        *colorSpace = srgb;
+    }
     // Multi-threaded parallel runner.
     auto runner = JxlResizableParallelRunnerMake(nullptr);
 
@@ -59,7 +68,12 @@ bool DecodeJpegXlOneShot(const uint8_t *jxl, size_t size,
         return false;
     }
 
-    JxlDecoderSetUnpremultiplyAlpha(dec.get(), JXL_TRUE);
+    // Caller that accepts premultiplied pixels gets alpha as stored, without unpremultiply pass
+    if (alphaPremultiplied) {
+        *alphaPremultiplied = false;
+    } else {
+        JxlDecoderSetUnpremultiplyAlpha(dec.get(), JXL_TRUE);
+    }
 
     JxlBasicInfo info;
     JxlPixelFormat format;
@@ -104,6 +118,9 @@ bool DecodeJpegXlOneShot(const uint8_t *jxl, size_t size,
             }
             *components = baseComponents;
             *exposedOrientation = static_cast<JxlExposedOrientation>(info.orientation);
+            if (alphaPremultiplied && info.alpha_bits > 0) {
+                *alphaPremultiplied = info.alpha_premultiplied == JXL_TRUE;
+            }
             if (bitDepth > 8 && pixelFormat == optimal) {
                 *useFloats = true;
                 hdrImage = true;
@@ -130,6 +147,45 @@ bool DecodeJpegXlOneShot(const uint8_t *jxl, size_t size,
             //                return false;
             //            }
 
+            // Gray is expanded to RGB, so its gray ICC profile doesn't describe the output.
+            // Neutral gray with D65 white looks the same in any D65 RGB space with the same transfer
+            if (info.num_color_channels == 1) {
+                JxlColorEncoding grayEncoding;
+                if (JXL_DEC_SUCCESS == JxlDecoderGetColorAsEncodedProfile(dec.get(), JXL_COLOR_PROFILE_TARGET_DATA,
+                                                                          &grayEncoding)
+                    && grayEncoding.white_point == JXL_WHITE_POINT_D65) {
+                    bool known = true;
+                    JxlEncodingColorSpace rgbSpace = srgb;
+                    switch (grayEncoding.transfer_function) {
+                        case JXL_TRANSFER_FUNCTION_SRGB:
+                            rgbSpace = srgb;
+                            break;
+                        case JXL_TRANSFER_FUNCTION_LINEAR:
+                            rgbSpace = linearSRGB;
+                            break;
+                        case JXL_TRANSFER_FUNCTION_709:
+                            rgbSpace = rec2020;
+                            break;
+                        case JXL_TRANSFER_FUNCTION_PQ:
+                            rgbSpace = rec2100PQ;
+                            break;
+                        case JXL_TRANSFER_FUNCTION_HLG:
+                            rgbSpace = rec2100HLG;
+                            break;
+                        default:
+                            known = false;
+                            break;
+                    }
+                    if (known) {
+                        iccProfile->clear();
+                        if (colorSpace) {
+                            *colorSpace = rgbSpace;
+                        }
+                        continue;
+                    }
+                }
+            }
+
             size_t icc_size;
             if (JXL_DEC_SUCCESS !=
                 JxlDecoderGetICCProfileSize(dec.get(), JXL_COLOR_PROFILE_TARGET_DATA,
@@ -223,78 +279,188 @@ bool DecodeBasicInfo(const uint8_t *jxl, size_t size, size_t *xsize, size_t *ysi
 }
 
 /**
- * Compresses the provided pixels.
+ * Declares the color space of the input pixels, so they're encoded as-is without conversion to sRGB.
+ * When ICC profile is not empty it takes precedence over the enumerated profile.
  *
+ * @param enc encoder with basic info already set
+ * @param colorProfile enumerated color encoding of the pixels
+ * @param iccProfile raw ICC profile of the pixels, may be empty
+ * @param isGray whether the pixels are grayscale
+ */
+bool JxlSetEncoderColorProfile(JxlEncoder* enc, JxlEncodingColorSpace colorProfile,
+                               const std::vector<uint8_t>& iccProfile, bool isGray) {
+    if (!iccProfile.empty()) {
+        return JXL_ENC_SUCCESS == JxlEncoderSetICCProfile(enc, iccProfile.data(), iccProfile.size());
+    }
+
+    JxlColorEncoding colorEncoding = {};
+    switch (colorProfile) {
+        case srgb:
+            JxlColorEncodingSetToSRGB(&colorEncoding, isGray);
+            break;
+        case linearSRGB:
+            JxlColorEncodingSetToLinearSRGB(&colorEncoding, isGray);
+            break;
+        case displayP3:
+            JxlColorEncodingSetToSRGB(&colorEncoding, isGray);
+            colorEncoding.primaries = JXL_PRIMARIES_P3;
+            break;
+        case rec2020:
+            // SDR Rec.2020 with the BT.709 transfer, which BT.2020 specifies for SDR content
+            // and which has no separate JXL code. HDR content is rec2100PQ or rec2100HLG.
+            JxlColorEncodingSetToSRGB(&colorEncoding, isGray);
+            colorEncoding.primaries = JXL_PRIMARIES_2100;
+            colorEncoding.transfer_function = JXL_TRANSFER_FUNCTION_709;
+            break;
+        case rec2100PQ:
+        case rec2100HLG:
+            // Enumerated transfers need no ICC, libjxl picks the intensity target for PQ.
+            // Relative intent as in the Rec.2100 descriptions of libjxl
+            JxlColorEncodingSetToSRGB(&colorEncoding, isGray);
+            colorEncoding.primaries = JXL_PRIMARIES_2100;
+            colorEncoding.transfer_function = colorProfile == rec2100PQ ? JXL_TRANSFER_FUNCTION_PQ
+                                                                         : JXL_TRANSFER_FUNCTION_HLG;
+            colorEncoding.rendering_intent = JXL_RENDERING_INTENT_RELATIVE;
+            break;
+    }
+    return JXL_ENC_SUCCESS == JxlEncoderSetColorEncoding(enc, &colorEncoding);
+}
+
+/**
+ * Compresses the provided pixels using already created encoder.
+ * Encoder must be freshly created or reset, parallel runner must be already attached if needed.
+ *
+ * @param enc encoder to use
  * @param pixels input pixels
  * @param xsize width of the input image
  * @param ysize height of the input image
  * @param compressed will be populated with the compressed bytes
+ * @param params encoding parameters
+ * @param scratch optional buffer for pixels with pruned channels, reused between calls if provided
+ * @param stats optional, will be populated with stage timings and encoder statistics
+ * @param runner optional, runner attached to the encoder whose tasks count into stage CPU times
  */
-bool EncodeJxlOneshot(const std::vector<uint8_t> &pixels, const uint32_t xsize,
-                      const uint32_t ysize, std::vector<uint8_t> *compressed,
-                      JxlPixelType colorspace, JxlCompressionOption compressionOption,
-                      float compressionDistance, int effort) {
-    auto enc = JxlEncoderMake(nullptr);
-    auto runner = JxlThreadParallelRunnerMake(nullptr,
-                                              JxlThreadParallelRunnerDefaultNumWorkerThreads());
-    if (JXL_ENC_SUCCESS != JxlEncoderSetParallelRunner(enc.get(),
-                                                       JxlThreadParallelRunner,
-                                                       runner.get())) {
+bool EncodeJxlWithEncoder(JxlEncoder* enc, const std::vector<uint8_t> &pixels, const uint32_t xsize,
+                          const uint32_t ysize, std::vector<uint8_t> *compressed,
+                          const JxlEncodingParams& params, std::vector<uint8_t>* scratch,
+                          JxlEncodeStatistics* stats, const JxlMeasuringRunner* runner) {
+    JxlImageView view;
+    view.data = pixels.data();
+    view.width = xsize;
+    view.height = ysize;
+    view.components = params.colorspace == rgba ? 4 : 3;
+    if (pixels.size() < static_cast<size_t>(xsize) * ysize * view.components) {
         return false;
     }
+    return EncodeJxlWithEncoder(enc, view, compressed, params, scratch, stats, runner);
+}
 
-    JxlPixelFormat pixel_format = {3, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0};
-    switch (colorspace) {
-        case rgb:
-            pixel_format = {3, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0};
-            break;
-        case rgba:
-            pixel_format = {4, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0};
-            break;
+/**
+ * Compresses pixels of the view without copying them when the layout is understood by libjxl.
+ * Pixels are packed once into scratch only if alpha is skipped or channels are pruned.
+ * params.colorspace is ignored, layout is defined by the view.
+ *
+ * @param enc encoder to use, freshly created or reset
+ * @param view pixels to compress, must stay alive until the function returns
+ * @param compressed will be populated with the compressed bytes
+ * @param params encoding parameters
+ * @param scratch optional buffer for packed pixels, reused between calls if provided
+ * @param stats optional, will be populated with stage timings and encoder statistics
+ * @param runner optional, runner attached to the encoder whose tasks count into stage CPU times
+ */
+bool EncodeJxlWithEncoder(JxlEncoder* enc, const JxlImageView& view,
+                          std::vector<uint8_t> *compressed,
+                          const JxlEncodingParams& params, std::vector<uint8_t>* scratch,
+                          JxlEncodeStatistics* stats, const JxlMeasuringRunner* runner) {
+    if (stats) {
+        // Timings accumulate per stage, leftovers of a previous encode would mix with this one
+        *stats = JxlEncodeStatistics();
+    }
+    // Each emplace finishes the previous stage
+    std::optional<JxlStageTimer> timer;
+    timer.emplace(stats ? &stats->setup : nullptr, runner);
+
+    if (!view.data || (view.components != 3 && view.components != 4)) {
+        return false;
+    }
+
+    const uint32_t xsize = view.width;
+    const uint32_t ysize = view.height;
+    const int components = view.components;
+    const size_t rowSize = static_cast<size_t>(xsize) * components;
+    const size_t stride = view.stride ? view.stride : rowSize;
+    if (stride < rowSize) {
+        return false;
+    }
+
+    const uint8_t* data = view.data;
+    size_t dataSize = stride * (ysize > 0 ? ysize - 1 : 0) + rowSize;
+    size_t align = stride != rowSize ? stride : 0;
+    int numChannels = components;
+
+    JxlPixelTraits traits;
+    if (params.pruneChannels) {
+        // ICC profile describes RGB channels, so gray pixels must be kept as RGB
+        traits = JxlAnalyzePixels(data, xsize, ysize, stride, components,
+                                  params.collapseGray && params.iccProfile.empty());
+    }
+    if (view.skipAlpha && components == 4) {
+        traits.opaque = true;
     }
 
+    std::vector<uint8_t> localScratch;
+    if (traits.opaque || traits.grayscale) {
+        auto& compacted = scratch ? *scratch : localScratch;
+        numChannels = JxlCompactPixels(data, xsize, ysize, stride, components, traits, compacted);
+        data = compacted.data();
+        dataSize = compacted.size();
+        align = 0;
+    }
+
+    const bool hasAlpha = numChannels == 2 || numChannels == 4;
+    const bool isGray = numChannels < 3;
+
+    // Row stride of libjxl is the row size rounded up to align, so any stride >= row size fits
+    JxlPixelFormat pixel_format = {static_cast<uint32_t>(numChannels), JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, align};
+
     JxlBasicInfo basicInfo;
     JxlEncoderInitBasicInfo(&basicInfo);
     basicInfo.xsize = xsize;
     basicInfo.ysize = ysize;
     basicInfo.bits_per_sample = 8;
-    basicInfo.uses_original_profile = compressionOption == loosy ? JXL_FALSE : JXL_TRUE;
-    basicInfo.num_color_channels = 3;
+    basicInfo.uses_original_profile = params.compressionOption == loosy ? JXL_FALSE : JXL_TRUE;
+    basicInfo.num_color_channels = isGray ? 1 : 3;
 
-    if (colorspace == rgba) {
+    if (hasAlpha) {
         basicInfo.num_extra_channels = 1;
         basicInfo.alpha_bits = 8;
+        basicInfo.alpha_premultiplied = view.premultiplied;
     }
 
-    if (JXL_ENC_SUCCESS != JxlEncoderSetBasicInfo(enc.get(), &basicInfo)) {
+    if (JXL_ENC_SUCCESS != JxlEncoderSetBasicInfo(enc, &basicInfo)) {
         return false;
     }
 
-    switch (colorspace) {
-        case rgb:
-            basicInfo.num_color_channels = 3;
-            break;
-        case rgba:
-            basicInfo.num_color_channels = 4;
-            JxlExtraChannelInfo channelInfo;
-            JxlEncoderInitExtraChannelInfo(JXL_CHANNEL_ALPHA, &channelInfo);
-            channelInfo.bits_per_sample = 8;
-            channelInfo.alpha_premultiplied = false;
-            if (JXL_ENC_SUCCESS != JxlEncoderSetExtraChannelInfo(enc.get(), 0, &channelInfo)) {
-                return false;
-            }
-            break;
+    if (hasAlpha) {
+        JxlExtraChannelInfo channelInfo;
+        JxlEncoderInitExtraChannelInfo(JXL_CHANNEL_ALPHA, &channelInfo);
+        channelInfo.bits_per_sample = 8;
+        channelInfo.alpha_premultiplied = view.premultiplied;
+        if (JXL_ENC_SUCCESS != JxlEncoderSetExtraChannelInfo(enc, 0, &channelInfo)) {
+            return false;
+        }
     }
 
-    JxlColorEncoding color_encoding = {};
-    JxlColorEncodingSetToSRGB(&color_encoding, pixel_format.num_channels < 3);
-    if (JXL_ENC_SUCCESS !=
-        JxlEncoderSetColorEncoding(enc.get(), &color_encoding)) {
+    if (!JxlSetEncoderColorProfile(enc, params.colorProfile, params.iccProfile, isGray)) {
+        return false;
+    }
+
+    if (!JxlAddMetadataBoxes(enc, params.metadata)) {
         return false;
     }
 
     JxlEncoderFrameSettings *frameSettings =
-    JxlEncoderFrameSettingsCreate(enc.get(), nullptr);
+    JxlEncoderFrameSettingsCreate(enc, nullptr);
 
     JxlBitDepth depth;
     depth.bits_per_sample = 8;
@@ -304,43 +470,70 @@ bool EncodeJxlOneshot(const std::vector<uint8_t> &pixels, const uint32_t xsize,
         return false;
     }
 
-    if (JXL_ENC_SUCCESS != JxlEncoderSetFrameLossless(frameSettings, compressionOption == loseless)) {
+    if (JXL_ENC_SUCCESS != JxlEncoderSetFrameLossless(frameSettings, params.compressionOption == loseless)) {
         return false;
     }
 
     if (JXL_ENC_SUCCESS !=
-        JxlEncoderSetFrameDistance(frameSettings, compressionDistance)) {
+        JxlEncoderSetFrameDistance(frameSettings, params.distance)) {
         return false;
     }
 
-    if (colorspace == rgba) {
+    if (hasAlpha) {
         if (JXL_ENC_SUCCESS !=
-            JxlEncoderSetExtraChannelDistance(frameSettings, 0, compressionDistance)) {
+            JxlEncoderSetExtraChannelDistance(frameSettings, 0, params.distance)) {
             return false;
         }
     }
 
-
     if (JxlEncoderFrameSettingsSetOption(frameSettings,
-                                         JXL_ENC_FRAME_SETTING_EFFORT, effort) != JXL_ENC_SUCCESS) {
+                                         JXL_ENC_FRAME_SETTING_EFFORT, params.effort) != JXL_ENC_SUCCESS) {
         return false;
     }
 
+    if (params.progressive) {
+        if (JxlEncoderFrameSettingsSetOption(frameSettings,
+                                             JXL_ENC_FRAME_SETTING_RESPONSIVE, 1) != JXL_ENC_SUCCESS) {
+            return false;
+        }
+        // DC and AC passes exist only in VarDCT, lossless images are modular and rely on responsive only
+        if (params.compressionOption == loosy) {
+            if (JxlEncoderFrameSettingsSetOption(frameSettings,
+                                                 JXL_ENC_FRAME_SETTING_PROGRESSIVE_DC, 1) != JXL_ENC_SUCCESS) {
+                return false;
+            }
+            if (JxlEncoderFrameSettingsSetOption(frameSettings,
+                                                 JXL_ENC_FRAME_SETTING_QPROGRESSIVE_AC, 1) != JXL_ENC_SUCCESS) {
+                return false;
+            }
+        }
+    }
+
+    std::unique_ptr<JxlEncoderStats, decltype(&JxlEncoderStatsDestroy)> encoderStats(nullptr, JxlEncoderStatsDestroy);
+    if (stats) {
+        encoderStats.reset(JxlEncoderStatsCreate());
+        JxlEncoderCollectStats(frameSettings, encoderStats.get());
+    }
+
+    timer.emplace(stats ? &stats->addFrame : nullptr, runner);
+
     if (JXL_ENC_SUCCESS !=
         JxlEncoderAddImageFrame(frameSettings, &pixel_format,
-                                (void *) pixels.data(),
-                                sizeof(uint8_t) * pixels.size())) {
+                                (void *) data,
+                                sizeof(uint8_t) * dataSize)) {
         return false;
     }
 
-    JxlEncoderCloseInput(enc.get());
+    JxlEncoderCloseInput(enc);
+
+    timer.emplace(stats ? &stats->processOutput : nullptr, runner);
 
     compressed->resize(64);
     uint8_t *next_out = compressed->data();
     size_t avail_out = compressed->size() - (next_out - compressed->data());
     JxlEncoderStatus process_result = JXL_ENC_NEED_MORE_OUTPUT;
     while (process_result == JXL_ENC_NEED_MORE_OUTPUT) {
-        process_result = JxlEncoderProcessOutput(enc.get(), &next_out, &avail_out);
+        process_result = JxlEncoderProcessOutput(enc, &next_out, &avail_out);
         if (process_result == JXL_ENC_NEED_MORE_OUTPUT) {
             size_t offset = next_out - compressed->data();
             compressed->resize(compressed->size() * 2);
@@ -353,9 +546,147 @@ bool EncodeJxlOneshot(const std::vector<uint8_t> &pixels, const uint32_t xsize,
         return false;
     }
 
+    timer.reset();
+    if (stats) {
+        for (int key = 0; key < JXL_ENC_NUM_STATS; ++key) {
+            stats->values[key] = JxlEncoderStatsGet(encoderStats.get(), static_cast<JxlEncoderStatsKey>(key));
+        }
+        stats->compressedBytes = compressed->size();
+    }
+
     return true;
 }
 
+/**
+ * Compresses the provided pixels.
+ *
+ * @param pixels input pixels
+ * @param xsize width of the input image
+ * @param ysize height of the input image
+ * @param compressed will be populated with the compressed bytes
+ * @param stats optional, will be populated with encoding statistics
+ */
+bool EncodeJxlOneshot(const std::vector<uint8_t> &pixels, const uint32_t xsize,
+                      const uint32_t ysize, std::vector<uint8_t> *compressed,
+                      JxlPixelType colorspace, JxlCompressionOption compressionOption,
+                      float compressionDistance, int effort,
+                      JxlEncodeStatistics* stats) {
+    auto enc = JxlEncoderMake(nullptr);
+    const size_t numThreads = JxlThreadParallelRunnerDefaultNumWorkerThreads();
+    auto runner = JxlThreadParallelRunnerMake(nullptr, numThreads);
+    JxlMeasuringRunner measuringRunner(JxlThreadParallelRunner, runner.get());
+    if (JXL_ENC_SUCCESS != JxlEncoderSetParallelRunner(enc.get(),
+                                                       stats ? JxlMeasuringRunner::run : JxlThreadParallelRunner,
+                                                       stats ? static_cast<void*>(&measuringRunner) : runner.get())) {
+        return false;
+    }
+
+    JxlEncodingParams params;
+    params.colorspace = colorspace;
+    params.compressionOption = compressionOption;
+    params.distance = compressionDistance;
+    params.effort = effort;
+    if (!EncodeJxlWithEncoder(enc.get(), pixels, xsize, ysize, compressed, params, nullptr, stats,
+                              &measuringRunner)) {
+        return false;
+    }
+    if (stats) {
+        stats->finish(numThreads);
+    }
+    return true;
+}
+
+/**
+ * Finds the byte offsets in the file where each progressive pass can be rendered.
+ * File is fed to the decoder in chunks, so offsets are rounded up to the chunk size,
+ * which is ~0.4% of the file and not less than 1KB. The last offset is where the full image is done.
+ *
+ * @param jxl compressed image
+ * @param size size of the compressed image
+ * @param passOffsets will be populated with the offsets in ascending order
+ */
+bool JxlFindProgressivePasses(const uint8_t *jxl, size_t size, std::vector<size_t>* passOffsets) {
+    auto runner = JxlResizableParallelRunnerMake(nullptr);
+
+    auto dec = JxlDecoderMake(nullptr);
+    if (JXL_DEC_SUCCESS !=
+        JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_BASIC_INFO |
+                                  JXL_DEC_FRAME_PROGRESSION |
+                                  JXL_DEC_FULL_IMAGE)) {
+        return false;
+    }
+
+    if (JXL_DEC_SUCCESS != JxlDecoderSetParallelRunner(dec.get(),
+                                                       JxlResizableParallelRunner,
+                                                       runner.get())) {
+        return false;
+    }
+
+    if (JXL_DEC_SUCCESS != JxlDecoderSetProgressiveDetail(dec.get(), kPasses)) {
+        return false;
+    }
+
+    JxlBasicInfo info;
+    JxlPixelFormat format = {4, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0};
+    std::vector<uint8_t> pixels;
+
+    const size_t chunkSize = std::max(static_cast<size_t>(1024), size / 256);
+    size_t fed = std::min(chunkSize, size);
+    JxlDecoderSetInput(dec.get(), jxl, fed);
+    if (fed == size) {
+        JxlDecoderCloseInput(dec.get());
+    }
+
+    passOffsets->clear();
+
+    for (;;) {
+        JxlDecoderStatus status = JxlDecoderProcessInput(dec.get());
+
+        if (status == JXL_DEC_ERROR) {
+            return false;
+        } else if (status == JXL_DEC_NEED_MORE_INPUT) {
+            if (fed == size) {
+                return false;
+            }
+            size_t remaining = JxlDecoderReleaseInput(dec.get());
+            size_t consumed = fed - remaining;
+            fed = std::min(fed + chunkSize, size);
+            JxlDecoderSetInput(dec.get(), jxl + consumed, fed - consumed);
+            if (fed == size) {
+                JxlDecoderCloseInput(dec.get());
+            }
+        } else if (status == JXL_DEC_BASIC_INFO) {
+            if (JXL_DEC_SUCCESS != JxlDecoderGetBasicInfo(dec.get(), &info)) {
+                return false;
+            }
+            JxlResizableParallelRunnerSetThreads(
+                                                 runner.get(),
+                                                 JxlResizableParallelRunnerSuggestThreads(info.xsize, info.ysize));
+        } else if (status == JXL_DEC_NEED_IMAGE_OUT_BUFFER) {
+            size_t bufferSize;
+            if (JXL_DEC_SUCCESS !=
+                JxlDecoderImageOutBufferSize(dec.get(), &format, &bufferSize)) {
+                return false;
+            }
+            pixels.resize(bufferSize);
+            if (JXL_DEC_SUCCESS != JxlDecoderSetImageOutBuffer(dec.get(),
+                                                               &format,
+                                                               pixels.data(),
+                                                               pixels.size())) {
+                return false;
+            }
+        } else if (status == JXL_DEC_FRAME_PROGRESSION || status == JXL_DEC_FULL_IMAGE) {
+            if (passOffsets->empty() || passOffsets->back() != fed) {
+                passOffsets->push_back(fed);
+            }
+        } else if (status == JXL_DEC_SUCCESS) {
+            return true;
+        } else {
+            return false;
+        }
+    }
+}
+
 bool isJXL(std::vector<uint8_t>& src) {
     if (JXL_SIG_INVALID == JxlSignatureCheck(src.data(), src.size())) {
         return false;
@@ -33,6 +33,44 @@
 #ifdef __cplusplus
 
 #include "JxlDefinitions.h"
+#include <jxl/encode.h>
+#include "JxlEncodeStatistics.hpp"
+#include "JxlMetadata.hpp"
+
+struct JxlEncodingParams {
+    JxlPixelType colorspace = rgba;
+    JxlCompressionOption compressionOption = loosy;
+    float distance = 1.0f;
+    int effort = 7;
+    // Color encoding of the input pixels, ignored when ICC profile is not empty
+    JxlEncodingColorSpace colorProfile = srgb;
+    std::vector<uint8_t> iccProfile;
+    // Drop constant opaque alpha before encoding
+    bool pruneChannels = true;
+    // Also encode R == G == B images without ICC profile as gray, DecodeJpegXlOneShot expands them back to RGB
+    bool collapseGray = true;
+    // Progressive DC, responsive modular and quantized progressive AC for partial rendering on slow networks
+    bool progressive = false;
+    // Exif, XMP, JUMBF and other boxes written before codestream
+    std::vector<JxlMetadataBox> metadata;
+};
+
+/**
+ * Non owning view of interleaved 8-bit RGB or RGBA pixels.
+ */
+struct JxlImageView {
+    const uint8_t* data = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Bytes between rows starts, 0 for tightly packed rows
+    size_t stride = 0;
+    // 3 - RGB, 4 - RGBA
+    int components = 4;
+    // Encode RGBA memory as RGB
+    bool skipAlpha = false;
+    // Colors are already multiplied by alpha, with skipped alpha they're encoded as composited over black
+    bool premultiplied = false;
+};
 
 bool DecodeJpegXlOneShot(const uint8_t *jxl, size_t size,
                          std::vector<uint8_t> *pixels, size_t *xsize,
@@ -42,12 +80,28 @@ bool DecodeJpegXlOneShot(const uint8_t *jxl, size_t size,
                          int* components,
                          bool* useFloats,
                          JxlExposedOrientation* exposedOrientation,
-                         JxlDecodingPixelFormat pixelFormat);
+                         JxlDecodingPixelFormat pixelFormat,
+                         bool* alphaPremultiplied = nullptr,
+                         JxlEncodingColorSpace* colorSpace = nullptr);
 bool DecodeBasicInfo(const uint8_t *jxl, size_t size, size_t *xsize, size_t *ysize);
 bool EncodeJxlOneshot(const std::vector<uint8_t> &pixels, const uint32_t xsize,
                       const uint32_t ysize, std::vector<uint8_t> *compressed,
                       JxlPixelType colorspace, JxlCompressionOption compression_option,
-                      float compression_distance, int effort);
+                      float compression_distance, int effort,
+                      JxlEncodeStatistics* stats = nullptr);
+bool EncodeJxlWithEncoder(JxlEncoder* enc, const std::vector<uint8_t> &pixels, const uint32_t xsize,
+                          const uint32_t ysize, std::vector<uint8_t> *compressed,
+                          const JxlEncodingParams& params, std::vector<uint8_t>* scratch = nullptr,
+                          JxlEncodeStatistics* stats = nullptr, const JxlMeasuringRunner* runner = nullptr);
+bool EncodeJxlWithEncoder(JxlEncoder* enc, const JxlImageView& view,
+                          std::vector<uint8_t> *compressed,
+                          const JxlEncodingParams& params, std::vector<uint8_t>* scratch = nullptr,
+                          JxlEncodeStatistics* stats = nullptr, const JxlMeasuringRunner* runner = nullptr);
+
+bool JxlSetEncoderColorProfile(JxlEncoder* enc, JxlEncodingColorSpace colorProfile,
+                               const std::vector<uint8_t>& iccProfile, bool isGray);
+
+bool JxlFindProgressivePasses(const uint8_t *jxl, size_t size, std::vector<size_t>* passOffsets);
 
 bool isJXL(std::vector<uint8_t>& src);
 
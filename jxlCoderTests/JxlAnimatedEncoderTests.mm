@@ -0,0 +1,148 @@
+//
+//  JxlAnimatedEncoderTests.mm
+//  jxlCoderTests
+//
+
+#import <XCTest/XCTest.h>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "JxlAnimatedEncoder.hpp"
+#include "JxlOutputSink.hpp"
+
+static const int frameWidth = 64;
+static const int frameHeight = 48;
+static const int frameCount = 6;
+
+// Moving gradient with a half transparent band, different for every frame
+static std::vector<uint8_t> makeFrame(int frame) {
+    std::vector<uint8_t> pixels(frameWidth * frameHeight * 4);
+    for (int y = 0; y < frameHeight; ++y) {
+        for (int x = 0; x < frameWidth; ++x) {
+            uint8_t* pixel = pixels.data() + (y * frameWidth + x) * 4;
+            pixel[0] = static_cast<uint8_t>((x + frame * 7) * 4);
+            pixel[1] = static_cast<uint8_t>((y + frame * 3) * 5);
+            pixel[2] = static_cast<uint8_t>((x ^ y) + frame * 11);
+            pixel[3] = (y + frame) % 12 < 4 ? 128 : 255;
+        }
+    }
+    return pixels;
+}
+
+static std::unique_ptr<JxlAnimatedEncoder> makeEncoder(JxlCompressionOption compression) {
+    return std::make_unique<JxlAnimatedEncoder>(frameWidth, frameHeight, rgba, er8, compression, 0, 90, 3);
+}
+
+@interface JxlAnimatedEncoderTests : XCTestCase
+@end
+
+@implementation JxlAnimatedEncoderTests
+
+- (std::vector<uint8_t>)encodeAtOnce:(JxlCompressionOption)compression {
+    auto encoder = makeEncoder(compression);
+    for (int i = 0; i < frameCount; ++i) {
+        auto frame = makeFrame(i);
+        encoder->addFrame(frame, 40);
+    }
+    std::vector<uint8_t> encoded;
+    encoder->encode(encoded);
+    return encoded;
+}
+
+- (void)checkStreamedOutput:(JxlCompressionOption)compression enqueued:(bool)enqueued {
+    const std::vector<uint8_t> expected = [self encodeAtOnce:compression];
+    XCTAssertFalse(expected.empty());
+
+    std::vector<uint8_t> streamed;
+    size_t chunks = 0;
+    auto sink = std::make_shared<JxlCallbackSink>([&](const uint8_t* data, size_t size) {
+        streamed.insert(streamed.end(), data, data + size);
+        chunks += 1;
+        return true;
+    });
+    auto encoder = makeEncoder(compression);
+    encoder->setOutputSink(sink);
+    for (int i = 0; i < frameCount; ++i) {
+        if (enqueued) {
+            encoder->enqueueFrame(makeFrame(i), 40);
+        } else {
+            auto frame = makeFrame(i);
+            encoder->addFrame(frame, 40);
+        }
+    }
+    encoder->finish();
+
+    XCTAssertGreaterThan(chunks, 0);
+    XCTAssertEqual(encoder->getBytesWritten(), static_cast<uint64_t>(streamed.size()));
+    XCTAssertEqual(streamed.size(), expected.size());
+    XCTAssertTrue(streamed == expected, @"Streamed image differs from the one-shot encode");
+}
+
+- (void)testStreamedLosslessMatchesEncode {
+    [self checkStreamedOutput:loseless enqueued:false];
+}
+
+- (void)testStreamedLossyMatchesEncode {
+    [self checkStreamedOutput:loosy enqueued:false];
+}
+
+- (void)testStreamedQueuedFramesMatchEncode {
+    [self checkStreamedOutput:loosy enqueued:true];
+}
+
+- (void)testFailedSinkStopsEncoding {
+    auto sink = std::make_shared<JxlCallbackSink>([](const uint8_t*, size_t) {
+        return false;
+    });
+    auto encoder = makeEncoder(loosy);
+    encoder->setOutputSink(sink);
+    bool failed = false;
+    try {
+        for (int i = 0; i < frameCount; ++i) {
+            auto frame = makeFrame(i);
+            encoder->addFrame(frame, 40);
+        }
+        encoder->finish();
+    } catch (AnimatedEncoderError& err) {
+        failed = true;
+    }
+    XCTAssertTrue(failed);
+}
+
+- (void)testAbandonedFileSinkRemovesFile {
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:NSUUID.UUID.UUIDString];
+    std::string filePath = path.fileSystemRepresentation;
+    {
+        auto sink = std::make_shared<JxlFileSink>(filePath);
+        XCTAssertTrue(sink->isOpen());
+        auto encoder = makeEncoder(loosy);
+        encoder->setOutputSink(sink);
+        auto frame = makeFrame(0);
+        encoder->addFrame(frame, 40);
+    }
+    XCTAssertNotEqual(access(filePath.c_str(), F_OK), 0);
+}
+
+- (void)testFinishedFileSinkKeepsImage {
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:NSUUID.UUID.UUIDString];
+    std::string filePath = path.fileSystemRepresentation;
+    {
+        auto sink = std::make_shared<JxlFileSink>(filePath);
+        auto encoder = makeEncoder(loseless);
+        encoder->setOutputSink(sink);
+        for (int i = 0; i < frameCount; ++i) {
+            auto frame = makeFrame(i);
+            encoder->addFrame(frame, 40);
+        }
+        encoder->finish();
+    }
+    NSData* written = [NSData dataWithContentsOfFile:path];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    const std::vector<uint8_t> expected = [self encodeAtOnce:loseless];
+    XCTAssertEqual(static_cast<size_t>(written.length), expected.size());
+    XCTAssertTrue(written && memcmp(written.bytes, expected.data(), expected.size()) == 0);
+}
+
+@end
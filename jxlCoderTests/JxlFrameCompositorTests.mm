@@ -0,0 +1,252 @@
+//
+//  JxlFrameCompositorTests.mm
+//  jxlCoderTests
+//
+
+#import <XCTest/XCTest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+#include <jxl/encode.h>
+#include <jxl/encode_cxx.h>
+#include "JxlAnimatedDecoder.hpp"
+
+static const int canvasWidth = 96;
+static const int canvasHeight = 64;
+
+struct TestLayer {
+    int x0;
+    int y0;
+    int width;
+    int height;
+    JxlBlendMode blendMode;
+    int source;
+    int saveAs;
+    int duration;
+    std::vector<uint8_t> pixels;
+};
+
+/**
+ * Random cropped layers with every blend mode the compositor handles, chained through
+ * reference slots, with unshown zero duration layers in between. With binary alpha every
+ * blend result is exact, so both compositors must produce the same bytes.
+ * Unchained layers are all blended onto the background, each frame is a single blend.
+ */
+static std::vector<TestLayer> makeLayers(unsigned seed, int count, bool binaryAlpha, bool chained) {
+    std::mt19937 random(seed);
+    std::vector<TestLayer> layers;
+    // Opaque background saved to slot 1, every later layer has a saved source
+    TestLayer background = {0, 0, canvasWidth, canvasHeight, JXL_BLEND_REPLACE, 0, 1, 0};
+    background.pixels.resize(canvasWidth * canvasHeight * 4);
+    for (size_t i = 0; i < background.pixels.size(); ++i) {
+        background.pixels[i] = (i & 3) == 3 ? 255 : static_cast<uint8_t>(random());
+    }
+    layers.push_back(std::move(background));
+    bool saved[4] = {false, true, false, false};
+
+    static const JxlBlendMode modes[] = {JXL_BLEND_REPLACE, JXL_BLEND_ADD, JXL_BLEND_BLEND,
+                                         JXL_BLEND_MULADD, JXL_BLEND_MUL};
+    for (int i = 1; i < count; ++i) {
+        TestLayer layer;
+        layer.width = 1 + static_cast<int>(random() % canvasWidth);
+        layer.height = 1 + static_cast<int>(random() % canvasHeight);
+        layer.x0 = static_cast<int>(random() % (canvasWidth - layer.width + 1));
+        layer.y0 = static_cast<int>(random() % (canvasHeight - layer.height + 1));
+        layer.blendMode = modes[random() % 5];
+        do {
+            layer.source = chained ? static_cast<int>(random() % 4) : 1;
+        } while (!saved[layer.source]);
+        const bool last = i + 1 == count;
+        layer.duration = last || random() % 3 != 0 ? 40 : 0;
+        do {
+            layer.saveAs = static_cast<int>(random() % 4);
+        } while (!chained && layer.saveAs == 1);
+        // Shown layers saved as 0 are not kept, the last one is never kept
+        if (!last && (layer.duration == 0 || layer.saveAs != 0)) {
+            saved[layer.saveAs] = true;
+        }
+        layer.pixels.resize(layer.width * layer.height * 4);
+        for (size_t p = 0; p < layer.pixels.size(); ++p) {
+            if ((p & 3) != 3) {
+                layer.pixels[p] = static_cast<uint8_t>(random());
+            } else if (binaryAlpha) {
+                layer.pixels[p] = random() % 2 ? 255 : 0;
+            } else {
+                layer.pixels[p] = static_cast<uint8_t>(random());
+            }
+        }
+        layers.push_back(std::move(layer));
+    }
+    return layers;
+}
+
+static std::vector<uint8_t> encodeLayers(const std::vector<TestLayer>& layers) {
+    JxlEncoderPtr enc = JxlEncoderMake(nullptr);
+    JxlBasicInfo info;
+    JxlEncoderInitBasicInfo(&info);
+    info.xsize = canvasWidth;
+    info.ysize = canvasHeight;
+    info.bits_per_sample = 8;
+    info.alpha_bits = 8;
+    info.num_color_channels = 3;
+    info.num_extra_channels = 1;
+    info.uses_original_profile = JXL_TRUE;
+    info.have_animation = JXL_TRUE;
+    info.animation.tps_numerator = 1000;
+    info.animation.tps_denominator = 1;
+    info.animation.num_loops = 0;
+    if (JXL_ENC_SUCCESS != JxlEncoderSetBasicInfo(enc.get(), &info)) {
+        return {};
+    }
+    JxlColorEncoding color;
+    JxlColorEncodingSetToSRGB(&color, JXL_FALSE);
+    if (JXL_ENC_SUCCESS != JxlEncoderSetColorEncoding(enc.get(), &color)) {
+        return {};
+    }
+    JxlEncoderFrameSettings* settings = JxlEncoderFrameSettingsCreate(enc.get(), nullptr);
+    JxlEncoderSetFrameLossless(settings, JXL_TRUE);
+    JxlEncoderFrameSettingsSetOption(settings, JXL_ENC_FRAME_SETTING_EFFORT, 1);
+
+    const JxlPixelFormat format = {4, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0};
+    for (const TestLayer& layer : layers) {
+        JxlFrameHeader header;
+        JxlEncoderInitFrameHeader(&header);
+        header.duration = layer.duration;
+        header.layer_info.have_crop = JXL_TRUE;
+        header.layer_info.crop_x0 = layer.x0;
+        header.layer_info.crop_y0 = layer.y0;
+        header.layer_info.xsize = layer.width;
+        header.layer_info.ysize = layer.height;
+        header.layer_info.save_as_reference = layer.saveAs;
+        JxlEncoderInitBlendInfo(&header.layer_info.blend_info);
+        header.layer_info.blend_info.blendmode = layer.blendMode;
+        header.layer_info.blend_info.source = layer.source;
+        header.layer_info.blend_info.alpha = 0;
+        header.layer_info.blend_info.clamp = JXL_TRUE;
+        if (JXL_ENC_SUCCESS != JxlEncoderSetFrameHeader(settings, &header) ||
+            JXL_ENC_SUCCESS != JxlEncoderSetExtraChannelBlendInfo(settings, 0, &header.layer_info.blend_info) ||
+            JXL_ENC_SUCCESS != JxlEncoderAddImageFrame(settings, &format, layer.pixels.data(), layer.pixels.size())) {
+            return {};
+        }
+    }
+    JxlEncoderCloseInput(enc.get());
+
+    std::vector<uint8_t> compressed(64 * 1024);
+    uint8_t* nextOut = compressed.data();
+    size_t availOut = compressed.size();
+    JxlEncoderStatus status;
+    while ((status = JxlEncoderProcessOutput(enc.get(), &nextOut, &availOut)) == JXL_ENC_NEED_MORE_OUTPUT) {
+        size_t offset = nextOut - compressed.data();
+        compressed.resize(compressed.size() * 2);
+        nextOut = compressed.data() + offset;
+        availOut = compressed.size() - offset;
+    }
+    if (status != JXL_ENC_SUCCESS) {
+        return {};
+    }
+    compressed.resize(nextOut - compressed.data());
+    return compressed;
+}
+
+static int maxDifference(JxlFrame lhs, JxlFrame& rhs) {
+    if (lhs.pixels.size() != rhs.pixels.size()) {
+        return 256;
+    }
+    const uint8_t* a = lhs.pixels.data();
+    const uint8_t* b = rhs.pixels.data();
+    int difference = 0;
+    for (size_t i = 0; i < lhs.pixels.size(); ++i) {
+        difference = std::max(difference, std::abs(a[i] - b[i]));
+    }
+    return difference;
+}
+
+@interface JxlFrameCompositorTests : XCTestCase
+@end
+
+@implementation JxlFrameCompositorTests
+
+- (std::vector<uint8_t>)makeAnimation:(unsigned)seed binaryAlpha:(bool)binaryAlpha chained:(bool)chained {
+    std::vector<uint8_t> image = encodeLayers(makeLayers(seed, 90, binaryAlpha, chained));
+    XCTAssertFalse(image.empty(), @"Cannot encode layered animation");
+    return image;
+}
+
+// Frames of libjxl coalescing, the reference for the own compositor
+- (std::vector<JxlFrame>)coalescedFrames:(std::vector<uint8_t>&)image {
+    JxlAnimatedDecoder decoder(image, compositeLibjxl);
+    XCTAssertFalse(decoder.isIncrementalCompositing());
+    std::vector<JxlFrame> frames;
+    for (int i = 0; i < decoder.getNumberOfFrames(); ++i) {
+        frames.push_back(decoder.getFrame(i));
+    }
+    return frames;
+}
+
+- (void)testSequentialFramesMatchCoalescing {
+    for (unsigned seed = 1; seed <= 8; ++seed) {
+        std::vector<uint8_t> image = [self makeAnimation:seed binaryAlpha:true chained:true];
+        std::vector<JxlFrame> expected = [self coalescedFrames:image];
+
+        JxlAnimatedDecoder decoder(image, compositeIncremental);
+        XCTAssertEqual(decoder.getNumberOfFrames(), static_cast<int>(expected.size()));
+        for (int i = 0; i < static_cast<int>(expected.size()); ++i) {
+            XCTAssertEqual(maxDifference(decoder.getFrame(i), expected[i]), 0, @"Seed %u, frame %d", seed, i);
+        }
+        XCTAssertTrue(decoder.isIncrementalCompositing(), @"Seed %u fell back to libjxl", seed);
+    }
+}
+
+// Out of order access restores compositor checkpoints instead of composing from the start
+- (void)testSeekingMatchesCoalescing {
+    for (unsigned seed = 11; seed <= 14; ++seed) {
+        std::vector<uint8_t> image = [self makeAnimation:seed binaryAlpha:true chained:true];
+        std::vector<JxlFrame> expected = [self coalescedFrames:image];
+
+        JxlAnimatedDecoder decoder(image, compositeIncremental);
+        // Small budget spreads checkpoints out while frames are visited
+        decoder.setCheckpointBudget(3 * canvasWidth * canvasHeight * 4);
+        std::vector<int> order(expected.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = static_cast<int>(i);
+        }
+        std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+        for (int at : order) {
+            XCTAssertEqual(maxDifference(decoder.getFrame(at), expected[at]), 0, @"Seed %u, frame %d", seed, at);
+        }
+        XCTAssertTrue(decoder.isIncrementalCompositing(), @"Seed %u fell back to libjxl", seed);
+    }
+}
+
+// Reused buffers get only the changed area of the following frame copied
+- (void)testReusedBufferMatchesCoalescing {
+    std::vector<uint8_t> image = [self makeAnimation:21 binaryAlpha:true chained:true];
+    std::vector<JxlFrame> expected = [self coalescedFrames:image];
+
+    JxlAnimatedDecoder decoder(image, compositeIncremental);
+    std::vector<uint8_t> pixels;
+    int filled = -1;
+    for (int i = 0; i < static_cast<int>(expected.size()); ++i) {
+        decoder.getFrame(i, pixels, filled);
+        filled = i;
+        XCTAssertEqual(pixels.size(), expected[i].pixels.size());
+        XCTAssertTrue(pixels.size() == expected[i].pixels.size() &&
+                      memcmp(pixels.data(), expected[i].pixels.data(), pixels.size()) == 0, @"Frame %d", i);
+    }
+}
+
+// Partial alpha is blended in integers, libjxl blends in floats and may round a single blend the other way
+- (void)testFractionalAlphaWithinRounding {
+    std::vector<uint8_t> image = [self makeAnimation:31 binaryAlpha:false chained:false];
+    std::vector<JxlFrame> expected = [self coalescedFrames:image];
+
+    JxlAnimatedDecoder decoder(image, compositeIncremental);
+    for (int i = 0; i < static_cast<int>(expected.size()); ++i) {
+        XCTAssertLessThanOrEqual(maxDifference(decoder.getFrame(i), expected[i]), 1, @"Frame %d", i);
+    }
+}
+
+@end